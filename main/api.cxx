@@ -1,19 +1,25 @@
 #include "api.h"
 
-#include <cJSON.h>
 #include <esp_log.h>
 #include <esp_pm.h>
+#include <esp_timer.h>
 #include <sys/time.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <optional>
 
 #include "config.h"
 #include "defer.h"
+#include "history.h"
 #include "http2/http2_connection.h"
+#include "json_scanner.h"
+#include "modbus.h"
 #include "persistence.h"
 #include "sha512.h"
 
@@ -28,9 +34,16 @@ api::accumulated_power_response_t accumulated_power_response;
 
 api::request_status_t request_status_current_power;
 api::request_status_t request_status_accumulated_power;
+api::request_status_t request_status_backfill;
+
+history::day_t backfill_response;
 
 char date_from_request[Http2Request::MAX_DATE_LEN] = "";
 
+#if !MODBUS_SOURCE
+// Only kept open between requests in continuous mode
+Http2Connection connection(AESS_API_SERVER, &persistence::tls_cache, TLS_PIN_DEPTH);
+
 const char* get_timestamp() {
     static char timestamp[16];
     snprintf(timestamp, 16, "%llu", time(nullptr));
@@ -45,6 +58,15 @@ const char* calculate_secret(const char* timestamp) {
     return sha512::calculate(secret, strlen(secret));
 }
 
+const char* get_local_date() {
+    static char date[11];
+    time_t timeval = time(nullptr);
+    struct tm local;
+    strftime(date, 11, "%Y-%m-%d", localtime_r(&timeval, &local));
+
+    return date;
+}
+
 const char* get_date() {
     static char date[11];
     time_t timeval = time(nullptr);
@@ -53,113 +75,426 @@ const char* get_date() {
     return date;
 }
 
-cJSON* deserialize_response(const uint8_t* serialized_json, cJSON*& data, api::request_status_t& status,
-                            const char* endpoint) {
-    data = nullptr;
+const char* const serials[] = AESS_SERIALS;
+constexpr size_t SYSTEMS = sizeof(serials) / sizeof(serials[0]);
+
+// The requests of all systems are streams on the same connection
+static_assert(2 * SYSTEMS <= Http2Connection::MAX_PENDING_REQUESTS, "too many systems in AESS_SERIALS");
+
+// A backfill takes another stream per system
+constexpr bool BACKFILL_FITS = SYSTEMS <= BACKFILL_MAX_STREAMS && 3 * SYSTEMS <= Http2Connection::MAX_PENDING_REQUESTS;
+
+// The responses are scanned while they are being received, straight into the response structs of their system
+struct system_t {
+    api::current_power_response_t current_power;
+    api::accumulated_power_response_t accumulated_power;
+
+    float code_current_power;
+    float code_accumulated_power;
+
+    const JsonScanner::field_t fields_current_power[6] = {{.path = "code", .value = &code_current_power},
+                                                          {.path = "data.ppv", .value = &current_power.ppv},
+                                                          {.path = "data.pload", .value = &current_power.pload},
+                                                          {.path = "data.soc", .value = &current_power.soc},
+                                                          {.path = "data.pgrid", .value = &current_power.pgrid},
+                                                          {.path = "data.pbat", .value = &current_power.pbat}};
+
+    const JsonScanner::field_t fields_accumulated_power[7] = {
+        {.path = "code", .value = &code_accumulated_power},
+        {.path = "data.eCharge", .value = &accumulated_power.eCharge},
+        {.path = "data.eDischarge", .value = &accumulated_power.eDischarge},
+        {.path = "data.eGridCharge", .value = &accumulated_power.eGridCharge},
+        {.path = "data.eInput", .value = &accumulated_power.eInput},
+        {.path = "data.eOutput", .value = &accumulated_power.eOutput},
+        {.path = "data.epv", .value = &accumulated_power.epv}};
+
+    // The day's power curve is read one sample at a time, each one is recorded into the backfill when it is complete
+    float code_backfill;
+    float sample_pv_w{NAN};
+    float sample_load_w{NAN};
+    char sample_time[20];
+
+    const JsonScanner::field_t fields_backfill[3] = {{.path = "code", .value = &code_backfill},
+                                                     {.path = "data[].ppv", .value = &sample_pv_w},
+                                                     {.path = "data[].load", .value = &sample_load_w}};
+
+    const JsonScanner::string_field_t string_fields_backfill[1] = {
+        {.path = "data[].uploadTime", .value = sample_time, .size = sizeof(sample_time)}};
+
+    JsonScanner scanner_current_power{fields_current_power,
+                                      sizeof(fields_current_power) / sizeof(JsonScanner::field_t)};
+    JsonScanner scanner_accumulated_power{fields_accumulated_power,
+                                          sizeof(fields_accumulated_power) / sizeof(JsonScanner::field_t)};
+    JsonScanner scanner_backfill{fields_backfill, sizeof(fields_backfill) / sizeof(JsonScanner::field_t)};
+
+    api::request_status_t status_current_power;
+    api::request_status_t status_accumulated_power;
+    api::request_status_t status_backfill;
+
+    history::day_t backfill;
+
+    system_t() {
+        scanner_backfill.setStringFields(string_fields_backfill, 1);
+        scanner_backfill.setElementCallback("data[]", record_sample, this);
+    }
+
+    // The upload time is local time
+    static void record_sample(void* context) {
+        system_t& system = *reinterpret_cast<system_t*>(context);
 
-    cJSON* json = cJSON_Parse(reinterpret_cast<const char*>(serialized_json));
-    if (!json) {
-        ESP_LOGE(TAG, "invalid response - bad JSON: %s", serialized_json);
-        status = api::request_status_t::invalid_response;
-        return nullptr;
+        struct tm local = {};
+        local.tm_isdst = -1;
+
+        if (!std::isnan(system.sample_pv_w) && !std::isnan(system.sample_load_w) &&
+            sscanf(system.sample_time, "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon, &local.tm_mday,
+                   &local.tm_hour, &local.tm_min, &local.tm_sec) == 6) {
+            local.tm_year -= 1900;
+            local.tm_mon -= 1;
+
+            const time_t epoch = mktime(&local);
+            if (epoch > 0) history::record(system.backfill, epoch, system.sample_pv_w, system.sample_load_w);
+        }
+
+        system.sample_pv_w = system.sample_load_w = NAN;
+        system.sample_time[0] = '\0';
     }
+};
 
-    cJSON* code_serialized = cJSON_GetObjectItemCaseSensitive(json, "code");
+system_t systems[SYSTEMS];
 
-    if (!cJSON_IsNumber(code_serialized)) {
-        ESP_LOGE(TAG, "invalid response - no code field: %s", serialized_json);
+void scan_chunk(void* context, const char* data, size_t len) {
+    reinterpret_cast<JsonScanner*>(context)->feed(data, len);
+}
+
+void check_http_status(const Http2Request& request, api::request_status_t& status, const char* endpoint,
+                       const char* serial) {
+    if (request.getHttpStatus() == 200) return;
+
+    ESP_LOGE(TAG, "GET for %s (%s) failed with HTTP status %li", endpoint, serial, request.getHttpStatus());
+    status = api::request_status_t::http_error;
+}
+
+// The code field is the scanner's first field
+void evaluate_response(const JsonScanner& scanner, float code_field, api::request_status_t& status,
+                       const char* endpoint) {
+    if (!scanner.isComplete()) {
+        ESP_LOGE(TAG, "invalid response from %s - bad JSON", endpoint);
+        status = api::request_status_t::invalid_response;
+        return;
+    }
+
+    if (!scanner.isFound(0)) {
+        ESP_LOGE(TAG, "invalid response from %s - no code field", endpoint);
         status = api::request_status_t::invalid_response;
-        return json;
+        return;
     }
 
-    int code = round(cJSON_GetNumberValue(code_serialized));
+    int code = round(code_field);
 
     if (code == AESS_API_ERROR_RATE_LIMIT) {
         ESP_LOGE(TAG, "%s hit rate limit", endpoint);
         status = api::request_status_t::rate_limit;
-        return json;
+        return;
     }
 
     if (code != AESS_API_OK) {
         ESP_LOGE(TAG, "%s return API error %i", endpoint, code);
         status = api::request_status_t::api_error;
+        return;
     }
 
-    data = cJSON_GetObjectItemCaseSensitive(json, "data");
-    if (!cJSON_IsObject(data)) {
-        ESP_LOGE(TAG, "invalid response - no payload: %s", serialized_json);
+    if (!scanner.allFound()) {
+        ESP_LOGE(TAG, "invalid response from %s - invalid data schema", endpoint);
         status = api::request_status_t::invalid_response;
-        data = nullptr;
+    }
+}
 
-        return json;
+// The readings of all systems are added up (the SOC is averaged). A request counts as failed if it failed for any
+// system.
+void aggregate_responses() {
+    for (const system_t& system : systems) {
+        if (request_status_current_power == api::request_status_t::ok)
+            request_status_current_power = system.status_current_power;
+
+        if (request_status_accumulated_power == api::request_status_t::ok)
+            request_status_accumulated_power = system.status_accumulated_power;
+
+        if (request_status_backfill == api::request_status_t::ok) request_status_backfill = system.status_backfill;
+    }
+
+    if (request_status_backfill == api::request_status_t::ok) {
+        backfill_response = systems[0].backfill;
+        for (size_t i = 1; i < SYSTEMS; i++) history::add(backfill_response, systems[i].backfill);
     }
 
-    return json;
+    current_power_response = {};
+    accumulated_power_response = {};
+
+    for (size_t i = 0; i < SYSTEMS; i++) {
+        const api::current_power_response_t& current = systems[i].current_power;
+        const api::accumulated_power_response_t& accumulated = systems[i].accumulated_power;
+
+        if (SYSTEMS > 1 && systems[i].status_current_power == api::request_status_t::ok)
+            ESP_LOGI(TAG, "%s: ppv = %f | pload = %f | soc = %f | pgrid = %f | pbat = %f", serials[i], current.ppv,
+                     current.pload, current.soc, current.pgrid, current.pbat);
+
+        current_power_response.ppv += current.ppv;
+        current_power_response.pload += current.pload;
+        current_power_response.soc += current.soc / SYSTEMS;
+        current_power_response.pgrid += current.pgrid;
+        current_power_response.pbat += current.pbat;
+
+        accumulated_power_response.eCharge += accumulated.eCharge;
+        accumulated_power_response.eDischarge += accumulated.eDischarge;
+        accumulated_power_response.eGridCharge += accumulated.eGridCharge;
+        accumulated_power_response.eInput += accumulated.eInput;
+        accumulated_power_response.eOutput += accumulated.eOutput;
+        accumulated_power_response.epv += accumulated.epv;
+    }
 }
 
-void deserialize_current_power(const uint8_t* serialized_json) {
-    cJSON* data = nullptr;
-    cJSON* json = deserialize_response(serialized_json, data, request_status_current_power, AESS_API_CURRENT_POWER);
-    if (!json || !data || request_status_current_power != api::request_status_t::ok) return;
+Http2Connection::Status connect(Deadline& deadline) {
+    if (connection.isConnected()) {
+        if (connection.ping(std::min<uint32_t>(PING_TIMEOUT_MSEC, deadline.remaining())) ==
+            Http2Connection::Status::done)
+            return Http2Connection::Status::done;
 
-    Defer deallocate_json([&]() { cJSON_Delete(json); });
+        ESP_LOGW(TAG, "connection lost, reconnecting");
+    }
 
-    cJSON* ppv = cJSON_GetObjectItemCaseSensitive(data, "ppv");
-    cJSON* pload = cJSON_GetObjectItemCaseSensitive(data, "pload");
-    cJSON* soc = cJSON_GetObjectItemCaseSensitive(data, "soc");
-    cJSON* pgrid = cJSON_GetObjectItemCaseSensitive(data, "pgrid");
-    cJSON* pbat = cJSON_GetObjectItemCaseSensitive(data, "pbat");
+    const uint64_t now = static_cast<uint64_t>(time(nullptr));
+    const uint32_t cached_address =
+        now - persistence::ts_last_dns_update <= TTL_DNS_MINUTES * 60 ? persistence::stored_server_address : 0;
 
-    if (!cJSON_IsNumber(ppv) || !cJSON_IsNumber(pload) || !cJSON_IsNumber(soc) || !cJSON_IsNumber(pgrid) ||
-        !cJSON_IsNumber(pbat)) {
-        ESP_LOGE(TAG, "invalid response - invalid data schema: %s", serialized_json);
-        request_status_current_power = api::request_status_t::invalid_response;
-        return;
+    // both attempts share the timeout of the connect phase
+    const int64_t start = esp_timer_get_time();
+    const uint32_t timeout = deadline.timeout(Deadline::Phase::connect);
+    Http2Connection::Status status = connection.connect(timeout, cached_address);
+
+    if (status != Http2Connection::Status::done && cached_address != 0) {
+        persistence::reset_server_address();
+
+        const int64_t left = static_cast<int64_t>(timeout) - (esp_timer_get_time() - start) / 1000;
+
+        if (left > 0) {
+            ESP_LOGW(TAG, "connection to cached address failed, retrying with DNS lookup");
+            status = connection.connect(left);
+        }
     }
 
-    current_power_response = {.ppv = static_cast<float>(cJSON_GetNumberValue(ppv)),
-                              .pload = static_cast<float>(cJSON_GetNumberValue(pload)),
-                              .soc = static_cast<float>(cJSON_GetNumberValue(soc)),
-                              .pgrid = static_cast<float>(cJSON_GetNumberValue(pgrid)),
-                              .pbat = static_cast<float>(cJSON_GetNumberValue(pbat))};
+    if (status != Http2Connection::Status::failed) deadline.record(Deadline::Phase::connect, start);
+
+    if (status == Http2Connection::Status::done && cached_address == 0) {
+        persistence::stored_server_address = connection.getPeerAddress();
+        persistence::ts_last_dns_update = now;
+    }
+
+    return status;
 }
+#else
+struct modbus_value_t {
+    uint16_t address;
+    uint16_t registers;
+    uint32_t* value;
+};
 
-void deserialize_accumulated_power(const uint8_t* serialized_json) {
-    cJSON* data = nullptr;
-    cJSON* json =
-        deserialize_response(serialized_json, data, request_status_accumulated_power, AESS_API_ACCUMULATED_POWER);
-    if (!json || !data || request_status_accumulated_power != api::request_status_t::ok) return;
-
-    Defer deallocate_json([&]() { cJSON_Delete(json); });
-
-    cJSON* eCharge = cJSON_GetObjectItemCaseSensitive(data, "eCharge");
-    cJSON* eDischarge = cJSON_GetObjectItemCaseSensitive(data, "eDischarge");
-    cJSON* eGridCharge = cJSON_GetObjectItemCaseSensitive(data, "eGridCharge");
-    cJSON* eInput = cJSON_GetObjectItemCaseSensitive(data, "eInput");
-    cJSON* eOutput = cJSON_GetObjectItemCaseSensitive(data, "eOutput");
-    cJSON* epv = cJSON_GetObjectItemCaseSensitive(data, "epv");
-
-    if (!cJSON_IsNumber(eCharge) || !cJSON_IsNumber(eDischarge) || !cJSON_IsNumber(eGridCharge) ||
-        !cJSON_IsNumber(eInput) || !cJSON_IsNumber(eOutput) || !cJSON_IsNumber(epv)) {
-        ESP_LOGE(TAG, "invalid response - invlid data schema: %s", serialized_json);
-        request_status_current_power = api::request_status_t::invalid_response;
-        return;
+// Reads values sorted by address with one request per run of contiguous registers, each request gets what is left
+// of the time until end (esp_timer_get_time() scale)
+modbus::status_t read_values(const modbus_value_t* values, size_t count, int64_t end) {
+    for (size_t first = 0, last; first < count; first = last + 1) {
+        uint16_t registers = values[first].registers;
+
+        for (last = first; last + 1 < count; last++) {
+            const modbus_value_t& next = values[last + 1];
+            if (next.address != values[first].address + registers || registers + next.registers > modbus::MAX_REGISTERS)
+                break;
+
+            registers += next.registers;
+        }
+
+        const int64_t left = (end - esp_timer_get_time()) / 1000;
+        if (left <= 0) return modbus::status_t::timeout;
+
+        modbus::set_timeout(left);
+
+        uint16_t data[modbus::MAX_REGISTERS];
+
+        const modbus::status_t status = modbus::read_registers(MODBUS_UNIT_ID, values[first].address, registers, data);
+        if (status != modbus::status_t::ok) return status;
+
+        const uint16_t* word = data;
+
+        for (size_t i = first; i <= last; i++) {
+            *values[i].value = values[i].registers == 2 ? (static_cast<uint32_t>(word[0]) << 16) | word[1] : word[0];
+            word += values[i].registers;
+        }
     }
 
-    accumulated_power_response = {.eCharge = static_cast<float>(cJSON_GetNumberValue(eCharge)),
-                                  .eDischarge = static_cast<float>(cJSON_GetNumberValue(eDischarge)),
-                                  .eGridCharge = static_cast<float>(cJSON_GetNumberValue(eGridCharge)),
-                                  .eInput = static_cast<float>(cJSON_GetNumberValue(eInput)),
-                                  .eOutput = static_cast<float>(cJSON_GetNumberValue(eOutput)),
-                                  .epv = static_cast<float>(cJSON_GetNumberValue(epv))};
+    return modbus::status_t::ok;
 }
 
+// Today's energy from the lifetime counters. The baseline is the last reading before or the first reading after local
+// midnight, whichever is within MODBUS_BASELINE_WINDOW_SEC of it. A later first reading would leave out the energy
+// since midnight, false if there is none.
+bool update_accumulated_power(const api::accumulated_power_response_t& totals) {
+    const time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    const int32_t day = local.tm_year * 366 + local.tm_yday;
+    api::energy_baseline_t& baseline = persistence::energy_baseline;
+
+    if (baseline.day != day) {
+        struct tm midnight = local;
+        midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+        midnight.tm_isdst = -1;
+
+        const uint64_t start_of_day = mktime(&midnight);
+
+        baseline.day = day;
+        baseline.valid = true;
+
+        if (baseline.last_epoch != 0 && baseline.last_epoch < start_of_day &&
+            start_of_day - baseline.last_epoch <= MODBUS_BASELINE_WINDOW_SEC) {
+            ESP_LOGI(TAG, "new day, taking the last energy counters of the previous day as baseline");
+            baseline.totals = baseline.last_totals;
+        } else if (static_cast<uint64_t>(now) - start_of_day <= MODBUS_BASELINE_WINDOW_SEC) {
+            ESP_LOGI(TAG, "new day, taking energy counters as baseline");
+            baseline.totals = totals;
+        } else {
+            ESP_LOGW(TAG, "new day, but no energy counters from around midnight, daily energy is unknown today");
+            baseline.valid = false;
+        }
+    }
+
+    baseline.last_epoch = now;
+    baseline.last_totals = totals;
+
+    if (!baseline.valid) return false;
+
+    accumulated_power_response = {.eCharge = totals.eCharge - baseline.totals.eCharge,
+                                  .eDischarge = totals.eDischarge - baseline.totals.eDischarge,
+                                  .eGridCharge = totals.eGridCharge - baseline.totals.eGridCharge,
+                                  .eInput = totals.eInput - baseline.totals.eInput,
+                                  .eOutput = totals.eOutput - baseline.totals.eOutput,
+                                  .epv = totals.epv - baseline.totals.epv};
+
+    return true;
+}
+
+// Plain TCP on the LAN and no rate limit, so both responses are read on every request
+api::connection_status_t perform_local_request(Deadline& deadline) {
+    request_status_current_power = request_status_accumulated_power = api::request_status_t::pending;
+    request_status_backfill = api::request_status_t::no_request;
+    date_from_request[0] = '\0';
+
+    int64_t start = esp_timer_get_time();
+
+    switch (modbus::connect(MODBUS_IP, MODBUS_PORT, deadline.timeout(Deadline::Phase::connect))) {
+        case modbus::status_t::ok:
+            break;
+
+        case modbus::status_t::timeout:
+            deadline.record(Deadline::Phase::connect, start);
+            return api::connection_status_t::timeout;
+
+        default:
+            return api::connection_status_t::error;
+    }
+
+    deadline.record(Deadline::Phase::connect, start);
+
+    Defer defer_disconnect([]() { modbus::disconnect(); });
+
+    uint32_t grid_feed, grid_consume, grid_power, soc, charge, discharge, grid_charge, battery_power, pv_total;
+    uint32_t pv_power[MODBUS_PV_STRINGS];
+
+    modbus_value_t values[9 + MODBUS_PV_STRINGS] = {{MODBUS_REG_GRID_FEED_TOTAL, 2, &grid_feed},
+                                                    {MODBUS_REG_GRID_CONSUME_TOTAL, 2, &grid_consume},
+                                                    {MODBUS_REG_GRID_POWER, 2, &grid_power},
+                                                    {MODBUS_REG_BATTERY_SOC, 1, &soc},
+                                                    {MODBUS_REG_BATTERY_CHARGE_TOTAL, 2, &charge},
+                                                    {MODBUS_REG_BATTERY_DISCHARGE_TOTAL, 2, &discharge},
+                                                    {MODBUS_REG_BATTERY_GRID_CHARGE_TOTAL, 2, &grid_charge},
+                                                    {MODBUS_REG_BATTERY_POWER, 1, &battery_power},
+                                                    {MODBUS_REG_PV_TOTAL, 2, &pv_total}};
+
+    for (uint8_t i = 0; i < MODBUS_PV_STRINGS; i++)
+        values[9 + i] = {static_cast<uint16_t>(MODBUS_REG_PV_POWER + 4 * i), 2, &pv_power[i]};
+
+    std::sort(std::begin(values), std::end(values),
+              [](const modbus_value_t& a, const modbus_value_t& b) { return a.address < b.address; });
+
+    start = esp_timer_get_time();
+    const modbus::status_t status =
+        read_values(values, sizeof(values) / sizeof(modbus_value_t),
+                    start + 1000ll * deadline.timeout(Deadline::Phase::request));
+
+    if (status != modbus::status_t::failed) deadline.record(Deadline::Phase::request, start);
+
+    switch (status) {
+        case modbus::status_t::ok:
+            break;
+
+        case modbus::status_t::failed:
+            return api::connection_status_t::transfer_error;
+
+        case modbus::status_t::timeout:
+            return api::connection_status_t::timeout;
+
+        default:
+            request_status_current_power = request_status_accumulated_power = api::request_status_t::invalid_response;
+            return api::connection_status_t::ok;
+    }
+
+    float ppv = 0;
+    for (uint32_t power : pv_power) ppv += power;
+
+    current_power_response.ppv = ppv;
+    current_power_response.pgrid = static_cast<int32_t>(grid_power);
+    current_power_response.pbat = static_cast<int16_t>(battery_power);
+    current_power_response.soc = soc / 10.f;
+
+    // What is neither exported nor stored is consumed
+    current_power_response.pload =
+        current_power_response.ppv + current_power_response.pgrid + current_power_response.pbat;
+
+    const bool accumulated = update_accumulated_power({.eCharge = charge / 10.f,
+                                                       .eDischarge = discharge / 10.f,
+                                                       .eGridCharge = grid_charge / 10.f,
+                                                       .eInput = grid_consume / 100.f,
+                                                       .eOutput = grid_feed / 100.f,
+                                                       .epv = pv_total / 10.f});
+
+    request_status_current_power = api::request_status_t::ok;
+    request_status_accumulated_power = accumulated ? api::request_status_t::ok : api::request_status_t::no_request;
+
+    return api::connection_status_t::ok;
+}
+#endif
+
 }  // namespace
 
-void api::init() { esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "api lock", &pm_lock); }
+void api::init() {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "api lock", &pm_lock);
+#if !MODBUS_SOURCE
+    connection.enableRetries(REQUEST_MAX_ATTEMPTS, &persistence::api_latency, REQUEST_HEDGE_MIN_MSEC);
+#endif
+}
 
-api::connection_status_t api::perform_request() {
+api::connection_status_t api::perform_request(Deadline& deadline, bool backfill) {
+#if MODBUS_SOURCE
+    return perform_local_request(deadline);
+#else
     request_status_current_power = request_status_accumulated_power = request_status_t::pending;
+    request_status_backfill = request_status_t::no_request;
+
+    if (backfill && !BACKFILL_FITS) {
+        ESP_LOGW(TAG, "backfill of %u systems exceeds BACKFILL_MAX_STREAMS, skipped", SYSTEMS);
+        backfill = false;
+    }
+
+    if (backfill) request_status_backfill = request_status_t::pending;
 
     bool skip_request_accumulated_power =
         (static_cast<int64_t>(time(nullptr)) - persistence::ts_last_request_accumulated_power) <=
@@ -171,10 +506,8 @@ api::connection_status_t api::perform_request() {
     const char* secret = calculate_secret(timestamp);
     const char* date = get_date();
 
-    Http2Connection connection(AESS_API_SERVER);
-
     esp_pm_lock_acquire(pm_lock);
-    Http2Connection::Status status = connection.connect(CONNECTION_TIMEOUT_MSEC);
+    Http2Connection::Status status = connect(deadline);
     esp_pm_lock_release(pm_lock);
 
     switch (status) {
@@ -190,10 +523,13 @@ api::connection_status_t api::perform_request() {
             break;
     }
 
+#if !CONTINUOUS_MODE
     Defer defer_diconnect([&]() { connection.disconnect(); });
+#endif
 
-    Http2Request request_current_power(2048);
-    Http2Request request_accumulated_power(2048);
+    std::optional<Http2Request> requests_current_power[SYSTEMS];
+    std::optional<Http2Request> requests_accumulated_power[SYSTEMS];
+    std::optional<Http2Request> requests_backfill[SYSTEMS];
 
     const Http2Header headers[] = {{.name = "appId", .value = AESS_APP_ID},
                                    {.name = "timeStamp", .value = timestamp},
@@ -204,21 +540,47 @@ api::connection_status_t api::perform_request() {
 
     ESP_LOGI(TAG, "requesting date %s", date);
 
-    snprintf(uri, 128, "%s?sysSn=%s", AESS_API_CURRENT_POWER, AESS_SERIAL);
-    connection.addRequest(uri, &request_current_power, headers, 4);
+    for (size_t i = 0; i < SYSTEMS; i++) {
+        systems[i].scanner_current_power.reset();
+        requests_current_power[i].emplace(scan_chunk, &systems[i].scanner_current_power);
+
+        snprintf(uri, 128, "%s?sysSn=%s", AESS_API_CURRENT_POWER, serials[i]);
+        connection.addRequest(uri, &*requests_current_power[i], headers, 4, true);
+
+        if (!skip_request_accumulated_power) {
+            systems[i].scanner_accumulated_power.reset();
+            requests_accumulated_power[i].emplace(scan_chunk, &systems[i].scanner_accumulated_power);
 
-    if (!skip_request_accumulated_power) {
-        snprintf(uri, 128, "%s?sysSn=%s&queryDate=%s", AESS_API_ACCUMULATED_POWER, AESS_SERIAL, date);
-        connection.addRequest(uri, &request_accumulated_power, headers, 4);
+            snprintf(uri, 128, "%s?sysSn=%s&queryDate=%s", AESS_API_ACCUMULATED_POWER, serials[i], date);
+            connection.addRequest(uri, &*requests_accumulated_power[i], headers, 4);
+        }
+
+        if (backfill) {
+            history::clear(systems[i].backfill);
+            systems[i].scanner_backfill.reset();
+            requests_backfill[i].emplace(scan_chunk, &systems[i].scanner_backfill);
+
+            snprintf(uri, 128, "%s?sysSn=%s&queryDate=%s", AESS_API_DAY_POWER, serials[i], get_local_date());
+            connection.addRequest(uri, &*requests_backfill[i], headers, 4);
+        }
     }
 
-    switch (connection.executePendingRequests(REQUEST_TIMEOUT_MSEC)) {
+    const int64_t start = esp_timer_get_time();
+    status = connection.executePendingRequests(deadline.timeout(Deadline::Phase::request));
+
+    if (status != Http2Connection::Status::failed) deadline.record(Deadline::Phase::request, start);
+
+    switch (status) {
         case Http2Connection::Status::failed:
             ESP_LOGE(TAG, "transfer failed");
+            connection.disconnect();
+
             return connection_status_t::transfer_error;
 
         case Http2Connection::Status::timeout:
             ESP_LOGE(TAG, "request timeout");
+            connection.disconnect();
+
             return connection_status_t::timeout;
 
         default:
@@ -227,29 +589,45 @@ api::connection_status_t api::perform_request() {
 
     request_status_current_power = request_status_t::ok;
     if (!skip_request_accumulated_power) request_status_accumulated_power = request_status_t::ok;
+    if (backfill) request_status_backfill = request_status_t::ok;
 
-    if (request_current_power.getHttpStatus() != 200) {
-        ESP_LOGE(TAG, "GET for %s failed with HTTP status %li", AESS_API_CURRENT_POWER,
-                 request_current_power.getHttpStatus());
+    for (size_t i = 0; i < SYSTEMS; i++) {
+        system_t& system = systems[i];
 
-        request_status_current_power = request_status_t::http_error;
-    }
+        if (backfill) {
+            system.status_backfill = request_status_t::ok;
+            check_http_status(*requests_backfill[i], system.status_backfill, AESS_API_DAY_POWER, serials[i]);
 
-    strncpy(date_from_request, request_current_power.getDate(), Http2Request::MAX_DATE_LEN - 1);
-    date_from_request[Http2Request::MAX_DATE_LEN - 1] = '\0';
+            if (system.status_backfill == request_status_t::ok)
+                evaluate_response(system.scanner_backfill, system.code_backfill, system.status_backfill,
+                                  AESS_API_DAY_POWER);
+        }
+
+        system.status_current_power = request_status_t::ok;
+        system.status_accumulated_power =
+            skip_request_accumulated_power ? request_status_t::no_request : request_status_t::ok;
 
-    if (!skip_request_accumulated_power && request_accumulated_power.getHttpStatus() != 200) {
-        ESP_LOGE(TAG, "GET for %s failed with HTTP status %li", AESS_API_ACCUMULATED_POWER,
-                 request_accumulated_power.getHttpStatus());
+        check_http_status(*requests_current_power[i], system.status_current_power, AESS_API_CURRENT_POWER,
+                          serials[i]);
 
-        request_status_accumulated_power = request_status_t::http_error;
+        if (system.status_current_power == request_status_t::ok)
+            evaluate_response(system.scanner_current_power, system.code_current_power, system.status_current_power,
+                              AESS_API_CURRENT_POWER);
+
+        if (skip_request_accumulated_power) continue;
+
+        check_http_status(*requests_accumulated_power[i], system.status_accumulated_power,
+                          AESS_API_ACCUMULATED_POWER, serials[i]);
+
+        if (system.status_accumulated_power == request_status_t::ok)
+            evaluate_response(system.scanner_accumulated_power, system.code_accumulated_power,
+                              system.status_accumulated_power, AESS_API_ACCUMULATED_POWER);
     }
 
-    if (request_status_current_power == request_status_t::ok)
-        deserialize_current_power(request_current_power.getData());
+    strncpy(date_from_request, requests_current_power[0]->getDate(), Http2Request::MAX_DATE_LEN - 1);
+    date_from_request[Http2Request::MAX_DATE_LEN - 1] = '\0';
 
-    if (request_status_accumulated_power == request_status_t::ok)
-        deserialize_accumulated_power(request_accumulated_power.getData());
+    aggregate_responses();
 
     switch (request_status_accumulated_power) {
         case request_status_t::api_error:
@@ -263,6 +641,7 @@ api::connection_status_t api::perform_request() {
     }
 
     return connection_status_t::ok;
+#endif
 }
 
 api::request_status_t api::get_current_power_request_status() { return request_status_current_power; }
@@ -273,4 +652,8 @@ api::current_power_response_t& api::get_current_power_response() { return curren
 
 api::accumulated_power_response_t& api::get_accumulated_power_response() { return accumulated_power_response; }
 
+api::request_status_t api::get_backfill_request_status() { return request_status_backfill; }
+
+const history::day_t& api::get_backfill_response() { return backfill_response; }
+
 const char* api::get_date_from_request() { return date_from_request; }
@@ -1,6 +1,11 @@
 #ifndef _API_H_
 #define _API_H_
 
+#include <cstdint>
+
+#include "deadline.h"
+#include "history.h"
+
 namespace api {
 
 struct current_power_response_t {
@@ -20,13 +25,25 @@ struct accumulated_power_response_t {
     float epv;
 };
 
+// Lifetime energy counters at the start of the local day, as read from the inverter (Modbus source only)
+struct energy_baseline_t {
+    int32_t day;  // local date (tm_year * 366 + tm_yday), -1 if none
+    bool valid;   // read within MODBUS_BASELINE_WINDOW_SEC of local midnight
+    accumulated_power_response_t totals;
+
+    // Latest reading, the baseline of the next day if it is close enough to midnight
+    uint64_t last_epoch;
+    accumulated_power_response_t last_totals;
+};
+
 enum class request_status_t { pending, ok, invalid_response, http_error, api_error, rate_limit, no_request, timeout };
 
 enum class connection_status_t { pending, ok, error, timeout, transfer_error };
 
 void init();
 
-connection_status_t perform_request();
+// With backfill, today's power curve is fetched along with the current readings (cloud source only)
+connection_status_t perform_request(Deadline& deadline, bool backfill);
 
 request_status_t get_current_power_request_status();
 request_status_t get_accumulated_power_request_status();
@@ -34,6 +51,9 @@ request_status_t get_accumulated_power_request_status();
 current_power_response_t& get_current_power_response();
 accumulated_power_response_t& get_accumulated_power_response();
 
+request_status_t get_backfill_request_status();
+const history::day_t& get_backfill_response();
+
 const char* get_date_from_request();
 
 }  // namespace api
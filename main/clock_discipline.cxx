@@ -0,0 +1,153 @@
+#include "clock_discipline.h"
+
+#include <esp_log.h>
+#include <sys/time.h>
+
+#include <cmath>
+
+#include "config.h"
+#include "persistence.h"
+
+namespace {
+
+const char* TAG = "clock";
+
+// The RTC slow clock is calibrated against the crystal, but may still be off by some hundred ppm
+constexpr double INITIAL_DRIFT_SIGMA = 500e-6;
+
+// Random walk of the drift (with temperature), about 10 ppm per hour
+constexpr double DRIFT_NOISE = 10e-6 * 10e-6 / 3600;
+
+constexpr double ERROR_BOUND_SIGMAS = 3;
+constexpr double OUTLIER_SIGMAS = 6;
+
+clock_discipline::model_t& model = persistence::clock_model;
+
+int64_t now_usec() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+
+    return tv.tv_sec * 1000000ll + tv.tv_usec;
+}
+
+void step(int64_t delta_usec) {
+    if (delta_usec == 0) return;
+
+    const int64_t time_usec = now_usec() + delta_usec;
+    timeval tv = {.tv_sec = static_cast<time_t>(time_usec / 1000000),
+                  .tv_usec = static_cast<suseconds_t>(time_usec % 1000000)};
+
+    if (settimeofday(&tv, nullptr) != 0) {
+        ESP_LOGE(TAG, "failed to step system clock");
+        return;
+    }
+
+    model.ts_last_update_usec += delta_usec;
+}
+
+double elapsed_sec() { return std::fmax(static_cast<double>(now_usec() - model.ts_last_update_usec), 0.) / 1e6; }
+
+// P' = F P F^T + Q with F = [[1, dt], [0, 1]]
+void propagate(double (&p)[2][2], double dt) {
+    p[0][0] += dt * (p[0][1] + p[1][0]) + dt * dt * p[1][1] + DRIFT_NOISE * dt * dt * dt / 3;
+    p[0][1] += dt * p[1][1] + DRIFT_NOISE * dt * dt / 2;
+    p[1][0] = p[0][1];
+    p[1][1] += DRIFT_NOISE * dt;
+}
+
+// Propagates the model to now and returns the offset that has accumulated since the last update
+double predict() {
+    const double dt = elapsed_sec();
+
+    propagate(model.covariance, dt);
+    model.ts_last_update_usec = now_usec();
+
+    return model.drift * dt;
+}
+
+uint32_t error_bound_msec(const double (&p)[2][2]) { return ERROR_BOUND_SIGMAS * sqrt(p[0][0]) * 1000; }
+
+// Restarts the model from a single observation
+void reset(int64_t offset_usec, double variance, int64_t applied_usec) {
+    model.drift = 0;
+    model.covariance[0][0] = variance;
+    model.covariance[0][1] = model.covariance[1][0] = 0;
+    model.covariance[1][1] = INITIAL_DRIFT_SIGMA * INITIAL_DRIFT_SIGMA;
+    model.ts_last_update_usec = now_usec();
+
+    step(offset_usec - applied_usec);
+
+    ESP_LOGI(TAG, "set clock by %lli usec", offset_usec);
+}
+
+}  // namespace
+
+void clock_discipline::model_t::clear() {
+    ts_last_update_usec = 0;
+    drift = 0;
+    covariance[0][0] = covariance[0][1] = covariance[1][0] = covariance[1][1] = 0;
+}
+
+void clock_discipline::correct() {
+    if (model.ts_last_update_usec == 0) return;
+
+    const int64_t offset_usec = llround(predict() * 1e6);
+    step(offset_usec);
+
+    ESP_LOGI(TAG, "corrected clock by %lli usec (drift %.1f ppm, error bound %lu msec)", offset_usec,
+             model.drift * 1e6, error_bound_msec(model.covariance));
+}
+
+bool clock_discipline::needs_sync() {
+    if (model.ts_last_update_usec == 0) return true;
+
+    double p[2][2] = {{model.covariance[0][0], model.covariance[0][1]},
+                      {model.covariance[1][0], model.covariance[1][1]}};
+    propagate(p, elapsed_sec());
+
+    const uint32_t bound = error_bound_msec(p);
+    ESP_LOGI(TAG, "clock error bound %lu msec", bound);
+
+    return bound > CLOCK_MAX_ERROR_MSEC;
+}
+
+void clock_discipline::observe(int64_t offset_usec, uint32_t sigma_usec, int64_t applied_usec) {
+    const double offset = offset_usec / 1e6;
+    const double r = (sigma_usec / 1e6) * (sigma_usec / 1e6);
+
+    if (model.ts_last_update_usec == 0) {
+        reset(offset_usec, r, applied_usec);
+        return;
+    }
+
+    double(&p)[2][2] = model.covariance;
+
+    const double predicted = predict();
+    const double innovation = offset - predicted;
+    const double s = p[0][0] + r;
+
+    // Far outside of the error bound the model no longer describes the clock (e.g. it has been set elsewhere)
+    if (innovation * innovation > OUTLIER_SIGMAS * OUTLIER_SIGMAS * s) {
+        ESP_LOGW(TAG, "offset %lli usec does not match the model, restarting", offset_usec);
+        reset(offset_usec, r, applied_usec);
+        return;
+    }
+
+    const double k0 = p[0][0] / s;
+    const double k1 = p[1][0] / s;
+
+    const double estimate = predicted + k0 * innovation;
+    model.drift += k1 * innovation;
+
+    // P' = (I - K H) P with H = [1, 0]
+    const double p00 = p[0][0], p01 = p[0][1];
+    p[0][0] -= k0 * p00;
+    p[0][1] -= k0 * p01;
+    p[1][0] = p[0][1];
+    p[1][1] -= k1 * p01;
+
+    step(llround(estimate * 1e6) - applied_usec);
+
+    ESP_LOGI(TAG, "observed offset %lli usec, stepped clock by %lli usec (drift %.1f ppm, error bound %lu msec)",
+             offset_usec, llround(estimate * 1e6), model.drift * 1e6, error_bound_msec(p));
+}
@@ -0,0 +1,34 @@
+#ifndef _CLOCK_DISCIPLINE_H_
+#define _CLOCK_DISCIPLINE_H_
+
+#include <cstdint>
+
+namespace clock_discipline {
+
+// Standard deviations of the time sources. The HTTP date has a resolution of one second.
+constexpr uint32_t HTTP_DATE_SIGMA_USEC = 300000;
+constexpr uint32_t NTP_SIGMA_USEC = 50000;
+
+// Kalman filter over offset and drift rate of the system clock against true time. The estimated offset is stepped
+// into the system clock on every update, so only the drift and the covariance are kept.
+struct model_t {
+    int64_t ts_last_update_usec;  // system time, 0 before the first observation
+    double drift;                 // s/s
+    double covariance[2][2];      // offset (s) and drift (s/s)
+
+    void clear();
+};
+
+// Step the system clock by the drift accumulated since the last update, e.g. during deep sleep
+void correct();
+
+// Whether the error bound of the system clock exceeds CLOCK_MAX_ERROR_MSEC, or it has never been set
+bool needs_sync();
+
+// offset_usec is true time minus system time, applied_usec the part of it that has already been stepped into the
+// system clock (SNTP sets the time itself)
+void observe(int64_t offset_usec, uint32_t sigma_usec, int64_t applied_usec = 0);
+
+}  // namespace clock_discipline
+
+#endif  // _CLOCK_DISCIPLINE_H_
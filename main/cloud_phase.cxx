@@ -0,0 +1,98 @@
+#include "cloud_phase.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const char* TAG = "cloud-phase";
+
+constexpr uint32_t PERIOD = CLOUD_UPDATE_PERIOD_SEC;
+constexpr uint32_t BIN_SECONDS = PERIOD / cloud_phase::BINS;
+
+constexpr float SCORE_DECAY = 0.95;
+
+// The best bin has to beat the average by this much before updates are aligned to it
+constexpr float LOCK_MARGIN = 2;
+
+// The bin that most likely contains the refresh, -1 if there is none yet
+int best_bin(const cloud_phase::state_t& state) {
+    const float* best = max_element(state.score, state.score + cloud_phase::BINS);
+
+    float mean = 0;
+    for (uint8_t bin = 0; bin < cloud_phase::BINS; bin++) mean += state.score[bin] / cloud_phase::BINS;
+
+    return *best - mean >= LOCK_MARGIN ? best - state.score : -1;
+}
+
+}  // namespace
+
+void cloud_phase::clear(state_t& state) {
+    state.epoch = 0;
+    state.digest = 0;
+    fill_n(state.score, BINS, 0.f);
+}
+
+// FNV-1a
+uint32_t cloud_phase::digest(const void* data, size_t len) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 16777619u;
+
+    return hash;
+}
+
+void cloud_phase::observe(state_t& state, uint64_t epoch, uint32_t digest, bool may_repeat) {
+    const uint64_t gap = epoch - state.epoch;
+    const bool changed = digest != state.digest;
+
+    // Fetches a period or more apart always see a refresh in between
+    if (state.epoch != 0 && epoch > state.epoch && gap < PERIOD && (changed || !may_repeat)) {
+        const uint32_t start = state.epoch % PERIOD;
+
+        for (uint8_t bin = 0; bin < BINS; bin++) {
+            // Span of the bin relative to the previous fetch, which may wrap around the end of the period
+            const uint32_t offset = (bin * BIN_SECONDS + PERIOD - start) % PERIOD;
+            const bool wraps = offset + BIN_SECONDS > PERIOD;
+
+            const bool inside = !wraps && offset > 0 && offset + BIN_SECONDS <= gap;
+            const bool intersects = wraps || offset < gap;
+
+            state.score[bin] *= SCORE_DECAY;
+
+            // A change rules out the bins outside of the gap, no change those inside
+            if ((changed && !intersects) || (!changed && inside)) state.score[bin] -= 1;
+        }
+
+        ESP_LOGI(TAG, "response %s within %llu sec, refresh phase %i / %u", changed ? "changed" : "unchanged", gap,
+                 best_bin(state), BINS);
+    }
+
+    state.epoch = epoch;
+    state.digest = digest;
+}
+
+uint64_t cloud_phase::align(const state_t& state, uint64_t due, uint32_t interval) {
+    // More frequent updates are not moved, they keep the estimate up to date
+    if (interval < PERIOD) return due;
+
+    const int bin = best_bin(state);
+    if (bin < 0) return due;
+
+    const uint32_t target = ((bin + 1) * BIN_SECONDS + CLOUD_UPDATE_MARGIN_SEC) % PERIOD;
+
+    uint64_t aligned = due - due % PERIOD + target;
+
+    if (aligned + PERIOD / 2 < due)
+        aligned += PERIOD;
+    else if (aligned > due + PERIOD / 2)
+        aligned -= PERIOD;
+
+    ESP_LOGI(TAG, "moved network update by %lli sec to refresh phase %i / %u",
+             static_cast<int64_t>(aligned) - static_cast<int64_t>(due), bin, BINS);
+
+    return aligned;
+}
@@ -0,0 +1,38 @@
+#ifndef _CLOUD_PHASE_H_
+#define _CLOUD_PHASE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "config.h"
+
+// Learns when within CLOUD_UPDATE_PERIOD_SEC the cloud refreshes the current power. Two fetches less than a period
+// apart tell whether a refresh happened in between (the response changed) or not. Every bin of the period keeps a
+// score of how well it fits these observations, decaying so that the estimate follows a drifting phase. The response
+// carries no upload time, so an unchanged response is only taken as a sign of no refresh while its values keep moving
+// (with PV power), a refresh at night may well repeat the same values.
+namespace cloud_phase {
+
+constexpr uint8_t BINS = 30;
+
+static_assert(CLOUD_UPDATE_PERIOD_SEC % BINS == 0);
+
+struct state_t {
+    uint64_t epoch;  // of the last fetch, 0 if none
+    uint32_t digest;
+    float score[BINS];
+};
+
+void clear(state_t& state);
+
+uint32_t digest(const void* data, size_t len);
+
+// With may_repeat, the values may be the same across a refresh and only a changed response is learned from
+void observe(state_t& state, uint64_t epoch, uint32_t digest, bool may_repeat);
+
+// Moves a network update that is due at least a period from now to just after the expected refresh closest to it
+uint64_t align(const state_t& state, uint64_t due, uint32_t interval);
+
+}  // namespace cloud_phase
+
+#endif  // _CLOUD_PHASE_H_
@@ -14,6 +14,7 @@
 #define FORMAT_TIME "%H:%M:%S"
 #define FORMAT_DATE "%d.%m.%Y"
 #define FORMAT_DATETIME "%s Uhr / %s %s"
+#define FORMAT_DATA_AGE "Stand vor %llu min"
 
 #define LABEL_PV "PV"
 #define LABEL_PV_ACCUMULATED "heute"
@@ -26,28 +27,130 @@
 
 #define NTP_SERVER "pool.ntp.org"
 
+// Sites with several systems can define AESS_SERIALS in config_local.h as a list, e.g. {"AL1...", "AL2..."}. Their
+// readings are added up, at most four systems are supported.
+#ifndef AESS_SERIALS
+#define AESS_SERIALS {AESS_SERIAL}
+#endif
+
 #define AESS_API_SERVER "https://openapi.alphaess.com"
 #define AESS_API_CURRENT_POWER "/api/getLastPowerData"
 #define AESS_API_ACCUMULATED_POWER "/api/getOneDateEnergyBySn"
+#define AESS_API_DAY_POWER "/api/getOneDayPowerBySn"
 #define AESS_API_ERROR_RATE_LIMIT 6053
 #define AESS_API_OK 200
 
 #define RATE_LIMIT_CURRENT_POWER_SEC 10
 #define RATE_LIMIT_ACCUMULATED_POWER_SEC 300
 
-#define MAX_TIME_WITHOUT_TIME_SYNC_MINUTES 25
 #define TTL_CURRENT_POWER_MINUTES 5
 #define TTL_ACCUMULATED_POWER_MINUTES 15
 #define TTL_DHCP_LEASE_MINUTES 1440
+// lwIP does not report the TTL of DNS records, so the resolved API server address is cached for a fixed time
+#define TTL_DNS_MINUTES 60
+
+// The drift of the system clock (the RTC slow clock during deep sleep) is learned from the HTTP date and NTP, and
+// corrected on wake. NTP is queried only when the error bound (3 sigma) of the clock exceeds this.
+#define CLOCK_MAX_ERROR_MSEC 1000
 
+// Upper bounds of the phase timeouts. Once enough phases have been observed, a phase times out after its p99 duration
+// times PHASE_TIMEOUT_MARGIN (but not before PHASE_TIMEOUT_MIN_MSEC). All phases together may not take longer than
+// CYCLE_BUDGET_MSEC.
 #define WIFI_TIMEOUT_MSEC 10000
 #define NTP_TIMEOUT_MSEC 10000
 #define CONNECTION_TIMEOUT_MSEC 20000
 #define REQUEST_TIMEOUT_MSEC 20000
+#define PHASE_TIMEOUT_MARGIN 2
+#define PHASE_TIMEOUT_MIN_MSEC 2000
+#define CYCLE_BUDGET_MSEC 25000
+#define PING_TIMEOUT_MSEC 3000
+
+// API streams that fail with 5xx or are reset are reissued within REQUEST_TIMEOUT_MSEC. Only the current power stream
+// is also hedged once it takes longer than the observed latency (mean + 4 * deviation), but not before
+// REQUEST_HEDGE_MIN_MSEC. The daily energy endpoint allows one request per 300 s, a duplicate could answer first with
+// a rate limit error.
+#define REQUEST_MAX_ATTEMPTS 3
+#define REQUEST_HEDGE_MIN_MSEC 1000
+
+// With MODBUS_SOURCE set in config_local.h, PV, load, battery and grid are read from the inverter at MODBUS_IP over
+// Modbus TCP instead of the cloud API. Daily energy is derived from the lifetime counters read within
+// MODBUS_BASELINE_WINDOW_SEC of local midnight, it is not shown on a day without such a reading. The register defaults
+// follow the AlphaESS Modbus register list, check them against the list for your inverter and firmware. 32 bit values
+// span two registers, high word first.
+#define MODBUS_BASELINE_WINDOW_SEC 900
+#define MODBUS_PORT 502
+#define MODBUS_UNIT_ID 0x55
+#define MODBUS_REG_GRID_FEED_TOTAL 0x0010            // uint32, 0.01 kWh
+#define MODBUS_REG_GRID_CONSUME_TOTAL 0x0012         // uint32, 0.01 kWh
+#define MODBUS_REG_GRID_POWER 0x0021                 // int32, W, positive while importing
+#define MODBUS_REG_BATTERY_SOC 0x0102                // uint16, 0.1 %
+#define MODBUS_REG_BATTERY_CHARGE_TOTAL 0x0120       // uint32, 0.1 kWh
+#define MODBUS_REG_BATTERY_DISCHARGE_TOTAL 0x0122    // uint32, 0.1 kWh
+#define MODBUS_REG_BATTERY_GRID_CHARGE_TOTAL 0x0124  // uint32, 0.1 kWh
+#define MODBUS_REG_BATTERY_POWER 0x0126              // int16, W, positive while discharging
+#define MODBUS_REG_PV_POWER 0x041f                   // uint32, W, of the first string, the others follow every 4
+#define MODBUS_REG_PV_TOTAL 0x043e                   // uint32, 0.1 kWh
+#define MODBUS_PV_STRINGS 2
+
+// Chain depth of the server certificate that is pinned after the first successful verification (0: leaf,
+// 1: intermediate). -1 disables pinning and verifies against the full CA bundle on every handshake.
+#define TLS_PIN_DEPTH 1
 
 #define FULL_REFRESH_EVERY_CYCLE 15
 
-#define SLEEP_SECONDS 60
+// Render in four gray levels. Every update is a full refresh in this mode.
+#define DISPLAY_GRAYSCALE 0
+
+#define HISTORY_SLOT_MINUTES 15
+
+// After a gap of more than BACKFILL_MIN_GAP_SEC without readings (or on power-up), the missed part of today's history
+// is fetched with the next update, as one more stream per system. It is skipped if that takes more than
+// BACKFILL_MAX_STREAMS streams.
+#define BACKFILL_MIN_GAP_SEC 3600
+#define BACKFILL_MAX_STREAMS 2
+
+// The readings of every update, in steps of TIMESERIES_POWER_STEP_W watts and TIMESERIES_SOC_STEP percent. The newest
+// TIMESERIES_BLOCK_BYTES of them are kept in RTC memory, TIMESERIES_NVS_BLOCKS full blocks before them in NVS. Three
+// blocks fill a 4 KB NVS page, 12 of them leave a page of the default 24 KB partition to Wi-Fi and block rewrites.
+#define TIMESERIES_BLOCK_BYTES 1184
+#define TIMESERIES_NVS_BLOCKS 12
+#define TIMESERIES_POWER_STEP_W 10
+#define TIMESERIES_SOC_STEP 0.5
+#define CHART_HEIGHT 16
+#define CHART_COLUMN_WIDTH 2
+#define CHART_MIN_SCALE_W 1000
+#define CHART_SCALE_STEP_W 500
+
+// Decoded strikes of the most frequently drawn glyphs, kept in RTC memory. GLYPH_CACHE_GHOSTS glyphs that are not
+// cached are counted as candidates.
+#define GLYPH_CACHE_SIZE 1024
+#define GLYPH_CACHE_ENTRIES 32
+#define GLYPH_CACHE_GHOSTS 16
+
+// Between network updates the display wakes every CLOCK_UPDATE_SECONDS with the radio off, only to show the time
+// (0: every wake is a network update)
+#define CLOCK_UPDATE_SECONDS 60
+
+// The network update interval grows from NETWORK_UPDATE_SECONDS while PV and load are steady, i.e. while they are
+// expected to change by less than SCHEDULE_TOLERANCE_W. Night is between sunset and sunrise at LATITUDE / LONGITUDE
+// (degrees north / east). Consecutive Wi-Fi, NTP or connection failures back off exponentially, up to
+// BACKOFF_MAX_SECONDS.
+#define NETWORK_UPDATE_SECONDS 120
+#define NETWORK_UPDATE_DAY_MAX_SECONDS 300
+#define NETWORK_UPDATE_NIGHT_MAX_SECONDS 1800
+#define SCHEDULE_TOLERANCE_W 100
+#define BACKOFF_MAX_SECONDS 3600
+#define LATITUDE 52.52
+#define LONGITUDE 13.40
+
+// The cloud refreshes the current power every CLOUD_UPDATE_PERIOD_SEC. Once its phase has been learned, network
+// updates that are at least a period apart are moved to CLOUD_UPDATE_MARGIN_SEC after the expected refresh.
+#define CLOUD_UPDATE_PERIOD_SEC 300
+#define CLOUD_UPDATE_MARGIN_SEC 5
+
+// For mains-powered displays: stay awake with Wi-Fi in modem sleep and the API connection open, and update every
+// RATE_LIMIT_CURRENT_POWER_SEC seconds instead of going to deep sleep
+#define CONTINUOUS_MODE 0
 
 #define SPI_PIN_SCLK GPIO_NUM_13
 #define SPI_PIN_MOSI GPIO_NUM_14
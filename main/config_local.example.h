@@ -4,7 +4,11 @@
 #define AESS_APP_ID "xxx"
 #define AESS_SECRET "xxx"
 #define AESS_SERIAL "xxx"
+// #define AESS_SERIALS {"xxx", "xxx"}
 
 #define LOG_DEST_IP "xxx"
 #define LOG_DEST_PORT 1234
 #define UDP_LOGGING 0
+
+#define MODBUS_IP "xxx"
+#define MODBUS_SOURCE 0
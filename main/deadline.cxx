@@ -0,0 +1,73 @@
+#include "deadline.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "config.h"
+
+using namespace std;
+
+namespace {
+
+const char* TAG = "deadline";
+
+// Fewer samples are not enough for an estimate
+constexpr uint8_t MIN_SAMPLES = 8;
+
+constexpr uint32_t max_timeout[] = {WIFI_TIMEOUT_MSEC, NTP_TIMEOUT_MSEC, CONNECTION_TIMEOUT_MSEC,
+                                    REQUEST_TIMEOUT_MSEC};
+static_assert(sizeof(max_timeout) / sizeof(uint32_t) == phase_latencies_t::PHASES);
+
+const char* phase_name[] = {"wifi", "ntp", "connect", "request"};
+
+uint32_t p99(const uint16_t* samples, uint8_t count) {
+    uint16_t sorted[phase_latencies_t::SAMPLES];
+    memcpy(sorted, samples, count * sizeof(uint16_t));
+
+    const size_t index = (99 * count + 99) / 100 - 1;
+    nth_element(sorted, sorted + index, sorted + count);
+
+    return sorted[index];
+}
+
+}  // namespace
+
+void phase_latencies_t::clear() {
+    memset(next, 0, sizeof(next));
+    memset(count, 0, sizeof(count));
+}
+
+Deadline::Deadline(uint32_t budget_msec, phase_latencies_t& latencies)
+    : end(esp_timer_get_time() + 1000ll * budget_msec), latencies(latencies) {}
+
+uint32_t Deadline::remaining() const { return max(end - esp_timer_get_time(), static_cast<int64_t>(0)) / 1000; }
+
+uint32_t Deadline::timeout(Phase phase) const {
+    const size_t index = static_cast<size_t>(phase);
+    const uint8_t count = latencies.count[index];
+
+    uint32_t timeout = max_timeout[index];
+
+    if (count >= MIN_SAMPLES)
+        timeout = clamp(PHASE_TIMEOUT_MARGIN * p99(latencies.samples_msec[index], count),
+                        static_cast<uint32_t>(PHASE_TIMEOUT_MIN_MSEC), timeout);
+
+    const uint32_t left = remaining();
+
+    ESP_LOGI(TAG, "%s timeout %lu msec (%u samples, %lu msec left in cycle)", phase_name[index], min(timeout, left),
+             count, left);
+
+    return min(timeout, left);
+}
+
+void Deadline::record(Phase phase, int64_t start) {
+    const size_t index = static_cast<size_t>(phase);
+    const int64_t duration = (esp_timer_get_time() - start) / 1000;
+
+    latencies.samples_msec[index][latencies.next[index]] = min(duration, static_cast<int64_t>(UINT16_MAX));
+    latencies.next[index] = (latencies.next[index] + 1) % phase_latencies_t::SAMPLES;
+    if (latencies.count[index] < phase_latencies_t::SAMPLES) latencies.count[index]++;
+}
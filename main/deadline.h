@@ -0,0 +1,45 @@
+#ifndef _DEADLINE_H_
+#define _DEADLINE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Recent durations of the phases of a wake cycle, a ring buffer per phase
+struct phase_latencies_t {
+    static constexpr size_t PHASES = 4;
+    static constexpr size_t SAMPLES = 32;
+
+    uint16_t samples_msec[PHASES][SAMPLES];
+    uint8_t next[PHASES];
+    uint8_t count[PHASES];
+
+    void clear();
+};
+
+/// Time budget of a wake cycle. Every phase gets p99 of its recent durations times a margin as timeout (the
+/// configured phase timeout as long as there are too few samples), capped by what is left of the cycle's budget.
+class Deadline {
+   public:
+    enum class Phase : uint8_t { wifi, ntp, connect, request };
+
+   public:
+    Deadline(uint32_t budget_msec, phase_latencies_t& latencies);
+
+    uint32_t remaining() const;
+    uint32_t timeout(Phase phase) const;
+
+    // Record the duration of a phase, start is the esp_timer_get_time() at its beginning
+    void record(Phase phase, int64_t start);
+
+   private:
+    const int64_t end;
+    phase_latencies_t& latencies;
+
+   private:
+    Deadline(const Deadline&) = delete;
+    Deadline(Deadline&&) = delete;
+    Deadline& operator=(const Deadline&) = delete;
+    Deadline& operator=(Deadline&&) = delete;
+};
+
+#endif  // _DEADLINE_H_
@@ -5,6 +5,8 @@
 using namespace std;
 
 #include "glcdfont.h"
+#include "glyph_cache.h"
+#include "rle.h"
 
 #define _swap_int16_t(a, b) \
     {                       \
@@ -33,7 +35,7 @@ Adafruit_GFX::Adafruit_GFX() : buffer(make_unique<uint8_t[]>((_width * _height)
     memset(buffer.get(), 0xff, (_width * _height) >> 3);
 }
 
-const uint8_t *Adafruit_GFX::getBuffer() { return buffer.get(); }
+const uint8_t *Adafruit_GFX::getBuffer() const { return buffer.get(); }
 
 /**************************************************************************/
 /*!
@@ -111,8 +113,52 @@ void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint8_t color)
    @param    color 16-bit 5-6-5 Color to fill with
 */
 /**************************************************************************/
-void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint8_t color) {
-    for (int16_t xx = x; xx < x + w; xx++) drawPixel(xx, y, color);
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint8_t color) { fillSpan(x, y, w, color); }
+
+/**************************************************************************/
+/*!
+   @brief    Fill a horizontal span bytewise. Partial bytes at either end are
+   masked, the bytes inbetween are written in one go.
+    @param    x   Left-most x coordinate
+    @param    y   Row
+    @param    w   Width in pixels
+    @param    color 1 for black, 0 for white
+*/
+/**************************************************************************/
+void Adafruit_GFX::fillSpan(int16_t x, int16_t y, int16_t w, uint8_t color) {
+    if (y < 0 || y >= _height) return;
+
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+
+    if (x + w > _width) w = _width - x;
+    if (w <= 0) return;
+
+    uint8_t *row = buffer.get() + y * (_width >> 3);
+
+    const int16_t first = x >> 3;
+    const int16_t last = (x + w - 1) >> 3;
+
+    uint8_t mask_first = 0xff >> (x & 0x07);
+    const uint8_t mask_last = 0xff << (7 - ((x + w - 1) & 0x07));
+
+    if (first == last) mask_first &= mask_last;
+
+    if (color)
+        row[first] &= ~mask_first;
+    else
+        row[first] |= mask_first;
+
+    if (first == last) return;
+
+    if (last - first > 1) memset(row + first + 1, color ? 0x00 : 0xff, last - first - 1);
+
+    if (color)
+        row[last] &= ~mask_last;
+    else
+        row[last] |= mask_last;
 }
 
 /**************************************************************************/
@@ -127,9 +173,7 @@ void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint8_t color)
 */
 /**************************************************************************/
 void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color) {
-    for (int16_t i = x; i < x + w; i++) {
-        drawFastVLine(i, y, h, color);
-    }
+    for (int16_t j = y; j < y + h; j++) fillSpan(x, j, w, color);
 }
 
 /**************************************************************************/
@@ -265,19 +309,21 @@ void Adafruit_GFX::drawCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t c
 */
 /**************************************************************************/
 void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint8_t color) {
-    drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+    fillSpan(x0 - r, y0, 2 * r + 1, color);
     fillCircleHelper(x0, y0, r, 3, 0, color);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Quarter-circle drawer with fill, used for circles and roundrects
+    @brief  Half-circle drawer with fill, used for circles and roundrects.
+            The shape is built from horizontal spans.
     @param  x0       Center-point x coordinate
     @param  y0       Center-point y coordinate
     @param  r        Radius of circle
-    @param  corners  Mask bits indicating which quarters we're doing
-    @param  delta    Offset from center-point, used for round-rects
-    @param  color    16-bit 5-6-5 Color to fill with
+    @param  corners  Mask bits indicating which halves we're doing (1: lower,
+                     2: upper)
+    @param  delta    Horizontal offset from center-point, used for round-rects
+    @param  color    1 for black, 0 for white
 */
 /**************************************************************************/
 void Adafruit_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta, uint8_t color) {
@@ -286,13 +332,15 @@ void Adafruit_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t c
     int16_t ddF_y = -2 * r;
     int16_t x = 0;
     int16_t y = r;
-    int16_t px = x;
-    int16_t py = y;
 
     delta++;  // Avoid some +1's in the loop
 
     while (x < y) {
         if (f >= 0) {
+            // Leaving row y, it won't be widened any further
+            if (corners & 1) fillSpan(x0 - x, y0 + y, 2 * x + delta, color);
+            if (corners & 2) fillSpan(x0 - x, y0 - y, 2 * x + delta, color);
+
             y--;
             ddF_y += 2;
             f += ddF_y;
@@ -300,18 +348,9 @@ void Adafruit_GFX::fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t c
         x++;
         ddF_x += 2;
         f += ddF_x;
-        // These checks avoid double-drawing certain lines, important
-        // for the SSD1306 library which has an INVERT drawing mode.
-        if (x < (y + 1)) {
-            if (corners & 1) drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
-            if (corners & 2) drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
-        }
-        if (y != py) {
-            if (corners & 1) drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
-            if (corners & 2) drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
-            py = y;
-        }
-        px = x;
+
+        if (corners & 1) fillSpan(x0 - y, y0 + x, 2 * y + delta, color);
+        if (corners & 2) fillSpan(x0 - y, y0 - x, 2 * y + delta, color);
     }
 }
 
@@ -373,10 +412,10 @@ void Adafruit_GFX::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int
     int16_t max_radius = ((w < h) ? w : h) / 2;  // 1/2 minor axis
     if (r > max_radius) r = max_radius;
     // smarter version
-    fillRect(x + r, y, w - 2 * r, h, color);
-    // draw four corners
-    fillCircleHelper(x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
-    fillCircleHelper(x + r, y + r, r, 2, h - 2 * r - 1, color);
+    fillRect(x, y + r, w, h - 2 * r, color);
+    // draw top and bottom caps
+    fillCircleHelper(x + r, y + h - r - 1, r, 1, w - 2 * r - 1, color);
+    fillCircleHelper(x + r, y + r, r, 2, w - 2 * r - 1, color);
 }
 
 /**************************************************************************/
@@ -500,18 +539,7 @@ void Adafruit_GFX::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
 */
 /**************************************************************************/
 void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint8_t color) {
-    int16_t byteWidth = (w + 7) / 8;  // Bitmap scanline pad = whole byte
-    uint8_t b = 0;
-
-    for (int16_t j = 0; j < h; j++, y++) {
-        for (int16_t i = 0; i < w; i++) {
-            if (i & 7)
-                b <<= 1;
-            else
-                b = bitmap[j * byteWidth + i / 8];
-            if (b & 0x80) drawPixel(x + i, y, color);
-        }
-    }
+    blit(x, y, bitmap, (w + 7) / 8, 0, 0, w, h, color ? bitblt::rop_t::clear : bitblt::rop_t::set);
 }
 
 /**************************************************************************/
@@ -576,6 +604,92 @@ void Adafruit_GFX::drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int1
     }
 }
 
+/**************************************************************************/
+/*!
+   @brief      Draw a pre-shifted sprite (see tools/icon_atlas.py). The copy
+   matching the sub-byte alignment of x is combined with the framebuffer
+   bytewise, unset bits are transparent.
+    @param    x   Top left corner x coordinate
+    @param    y   Top left corner y coordinate
+    @param    sprite  The sprite
+    @param    color 1 for black, 0 for white
+*/
+/**************************************************************************/
+void Adafruit_GFX::drawSprite(int16_t x, int16_t y, const GFXsprite &sprite, uint8_t color) {
+    const int16_t stride = sprite.stride;
+    const int16_t first = x >> 3;
+    const uint8_t *data = sprite.data + (x & 0x07) * sprite.height * stride;
+
+    for (uint8_t yy = 0; yy < sprite.height; yy++, y++, data += stride) {
+        if (y < 0 || y >= _height) continue;
+
+        uint8_t *row = buffer.get() + y * (_width >> 3);
+
+        for (int16_t i = 0; i < stride; i++) {
+            const int16_t index = first + i;
+            if (index < 0 || index >= (_width >> 3)) continue;
+
+            if (color)
+                row[index] &= ~data[i];
+            else
+                row[index] |= data[i];
+        }
+    }
+}
+
+/**************************************************************************/
+/*!
+   @brief      Combine a 1bpp bitmap (MSB first, rows padded to whole bytes)
+   with the framebuffer. Note that set bits in the framebuffer are white.
+    @param    x   Top left corner x coordinate
+    @param    y   Top left corner y coordinate
+    @param    bitmap  Source bitmap
+    @param    stride  Bytes per source row
+    @param    src_x  Left-most source x coordinate
+    @param    src_y  Top-most source y coordinate
+    @param    w   Width in pixels
+    @param    h   Height in pixels
+    @param    rop Raster operation
+*/
+/**************************************************************************/
+void Adafruit_GFX::blit(int16_t x, int16_t y, const uint8_t *bitmap, uint16_t stride, int16_t src_x, int16_t src_y,
+                        int16_t w, int16_t h, bitblt::rop_t rop) {
+    if (x < 0) {
+        w += x;
+        src_x -= x;
+        x = 0;
+    }
+
+    if (y < 0) {
+        h += y;
+        src_y -= y;
+        y = 0;
+    }
+
+    if (x + w > _width) w = _width - x;
+    if (y + h > _height) h = _height - y;
+
+    bitblt::blit(buffer.get(), _width >> 3, x, y, bitmap, stride, src_x, src_y, w, h, rop);
+}
+
+/**************************************************************************/
+/*!
+   @brief      Combine a region of another framebuffer with this one
+    @param    x   Top left corner x coordinate
+    @param    y   Top left corner y coordinate
+    @param    src  Source framebuffer
+    @param    src_x  Left-most source x coordinate
+    @param    src_y  Top-most source y coordinate
+    @param    w   Width in pixels
+    @param    h   Height in pixels
+    @param    rop Raster operation
+*/
+/**************************************************************************/
+void Adafruit_GFX::blit(int16_t x, int16_t y, const Adafruit_GFX &src, int16_t src_x, int16_t src_y, int16_t w,
+                        int16_t h, bitblt::rop_t rop) {
+    blit(x, y, src.buffer.get(), _width >> 3, src_x, src_y, w, h, rop);
+}
+
 // TEXT- AND CHARACTER-HANDLING FUNCTIONS ----------------------------------
 
 // Draw a character
@@ -683,6 +797,22 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint8_t color
         // displays supporting setAddrWindow() and pushColors()), but haven't
         // implemented this yet.
 
+        if (size_x == 1 && size_y == 1 && w > 0 && h > 0) {
+            const uint8_t *strike = glyph_cache::lookup(gfxFont, glyph);
+
+            if (strike) {
+                blit(x + xo, y + yo, strike, (w + 7) >> 3, 0, 0, w, h,
+                     color ? bitblt::rop_t::clear : bitblt::rop_t::set);
+                return;
+            }
+        }
+
+        if (bo & GFX_GLYPH_RLE) {
+            drawRleGlyph(x + xo * size_x, y + yo * size_y, bitmap + (bo & ~GFX_GLYPH_RLE), w, h, color, size_x,
+                         size_y);
+            return;
+        }
+
         for (yy = 0; yy < h; yy++) {
             for (xx = 0; xx < w; xx++) {
                 if (!(bit++ & 7)) {
@@ -701,6 +831,30 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint8_t color
     }  // End classic vs custom font
 }
 
+/**************************************************************************/
+/*!
+   @brief   Draw a run-length encoded glyph (see tools/compress_font.py). Runs
+   are written to the framebuffer as spans.
+    @param    x   Top left corner x coordinate (glyph offset applied)
+    @param    y   Top left corner y coordinate (glyph offset applied)
+    @param    data  Encoded glyph bitmap
+    @param    w   Glyph width in pixels
+    @param    h   Glyph height in pixels
+    @param    color 1 for black, 0 for white
+    @param    size_x  Font magnification level in X-axis
+    @param    size_y  Font magnification level in Y-axis
+*/
+/**************************************************************************/
+void Adafruit_GFX::drawRleGlyph(int16_t x, int16_t y, const uint8_t *data, uint8_t w, uint8_t h, uint8_t color,
+                                uint8_t size_x, uint8_t size_y) {
+    if (size_x == 1 && size_y == 1)
+        rle::decode(data, w, h, [&](uint8_t xx, uint8_t yy, uint8_t run) { fillSpan(x + xx, y + yy, run, color); });
+    else
+        rle::decode(data, w, h, [&](uint8_t xx, uint8_t yy, uint8_t run) {
+            fillRect(x + xx * size_x, y + yy * size_y, run * size_x, size_y, color);
+        });
+}
+
 void Adafruit_GFX::write(char c) {
     if (!gfxFont) {  // 'Classic' built-in font
 
@@ -5,13 +5,15 @@
 #include <memory>
 #include <string>
 
+#include "bitblt.h"
 #include "gfxfont.h"
+#include "gfxsprite.h"
 
 class Adafruit_GFX {
    public:
     Adafruit_GFX();  // Constructor
 
-    const uint8_t *getBuffer();
+    const uint8_t *getBuffer() const;
 
     inline void drawPixel(int16_t x, int16_t y, uint8_t color) {
         if (x < 0 || y < 0) return;
@@ -49,6 +51,11 @@ class Adafruit_GFX {
     void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint8_t color);
     void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint8_t color, uint8_t bg);
     void drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint8_t color);
+    void drawSprite(int16_t x, int16_t y, const GFXsprite &sprite, uint8_t color);
+    void blit(int16_t x, int16_t y, const uint8_t *bitmap, uint16_t stride, int16_t src_x, int16_t src_y, int16_t w,
+              int16_t h, bitblt::rop_t rop);
+    void blit(int16_t x, int16_t y, const Adafruit_GFX &src, int16_t src_x, int16_t src_y, int16_t w, int16_t h,
+              bitblt::rop_t rop = bitblt::rop_t::copy);
     void drawChar(int16_t x, int16_t y, unsigned char c, uint8_t color, uint8_t bg, uint8_t size);
     void drawChar(int16_t x, int16_t y, unsigned char c, uint8_t color, uint8_t bg, uint8_t size_x, uint8_t size_y);
     void getTextBounds(const char *string, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h);
@@ -109,6 +116,11 @@ class Adafruit_GFX {
     int16_t getCursorY(void) const { return cursor_y; };
 
    private:
+    void fillSpan(int16_t x, int16_t y, int16_t w, uint8_t color);
+
+    void drawRleGlyph(int16_t x, int16_t y, const uint8_t *data, uint8_t w, uint8_t h, uint8_t color, uint8_t size_x,
+                      uint8_t size_y);
+
     void charBounds(unsigned char c, int16_t *x, int16_t *y, int16_t *minx, int16_t *miny, int16_t *maxx,
                     int16_t *maxy);
 
@@ -0,0 +1,76 @@
+#include "bitblt.h"
+
+namespace {
+
+// Load n bytes (1 - 4) as a big endian word, MSB aligned
+inline uint32_t load(const uint8_t* data, uint8_t n) {
+    uint32_t word = 0;
+    for (uint8_t i = 0; i < n; i++) word |= static_cast<uint32_t>(data[i]) << (24 - 8 * i);
+
+    return word;
+}
+
+inline void store(uint8_t* data, uint8_t n, uint32_t word) {
+    for (uint8_t i = 0; i < n; i++) data[i] = word >> (24 - 8 * i);
+}
+
+// Fetch n bits (1 - 32) starting at bit, MSB aligned
+inline uint32_t fetch(const uint8_t* row, uint32_t bit, uint8_t n) {
+    const uint8_t* data = row + (bit >> 3);
+    const uint8_t shift = bit & 0x07;
+    const uint8_t bytes = (shift + n + 7) >> 3;
+
+    if (bytes <= 4) return load(data, bytes) << shift;
+
+    return (load(data, 4) << shift) | (data[4] >> (8 - shift));
+}
+
+inline uint32_t apply(uint32_t dst, uint32_t src, uint32_t mask, bitblt::rop_t rop) {
+    switch (rop) {
+        case bitblt::rop_t::copy:
+            return (dst & ~mask) | (src & mask);
+
+        case bitblt::rop_t::set:
+            return dst | (src & mask);
+
+        case bitblt::rop_t::clear:
+            return dst & ~(src & mask);
+
+        case bitblt::rop_t::toggle:
+            return dst ^ (src & mask);
+    }
+
+    return dst;
+}
+
+}  // namespace
+
+void bitblt::blit(uint8_t* dst, uint16_t dst_stride, int16_t dst_x, int16_t dst_y, const uint8_t* src,
+                  uint16_t src_stride, int16_t src_x, int16_t src_y, int16_t w, int16_t h, rop_t rop) {
+    if (w <= 0 || h <= 0) return;
+
+    uint8_t* dst_row = dst + dst_y * dst_stride;
+    const uint8_t* src_row = src + src_y * src_stride;
+
+    for (int16_t yy = 0; yy < h; yy++, dst_row += dst_stride, src_row += src_stride) {
+        uint32_t dst_bit = dst_x;
+        uint32_t src_bit = src_x;
+        int16_t remaining = w;
+
+        while (remaining > 0) {
+            const uint8_t offset = dst_bit & 0x07;
+            const uint8_t n = remaining < 32 - offset ? remaining : 32 - offset;
+            const uint8_t bytes = (offset + n + 7) >> 3;
+
+            const uint32_t mask = (n == 32 ? 0xffffffff : ~(0xffffffff >> n)) >> offset;
+            const uint32_t word = fetch(src_row, src_bit, n) >> offset;
+
+            uint8_t* target = dst_row + (dst_bit >> 3);
+            store(target, bytes, apply(load(target, bytes), word, mask, rop));
+
+            dst_bit += n;
+            src_bit += n;
+            remaining -= n;
+        }
+    }
+}
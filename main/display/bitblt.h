@@ -0,0 +1,22 @@
+#ifndef _BITBLT_H_
+#define _BITBLT_H_
+
+#include <cstdint>
+
+// Copy 1bpp rectangles (MSB first) between buffers at arbitrary bit offsets. Rows are processed in 32 bit windows
+// aligned to the destination bytes. No clipping is done here, this is up to the caller.
+namespace bitblt {
+
+enum class rop_t {
+    copy,   // dst = src
+    set,    // dst = dst OR src
+    clear,  // dst = dst AND NOT src
+    toggle  // dst = dst XOR src
+};
+
+void blit(uint8_t* dst, uint16_t dst_stride, int16_t dst_x, int16_t dst_y, const uint8_t* src, uint16_t src_stride,
+          int16_t src_x, int16_t src_y, int16_t w, int16_t h, rop_t rop);
+
+}  // namespace bitblt
+
+#endif  // _BITBLT_H_
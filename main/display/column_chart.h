@@ -0,0 +1,70 @@
+#ifndef _COLUMN_CHART_H_
+#define _COLUMN_CHART_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "adagfx.h"
+
+/// Column chart rendered into a 1bpp bitmap (MSB first, set bits are drawn). The bitmap and the column heights are
+/// kept between renders and only columns whose height changed are redrawn, so the chart can live in RTC memory and
+/// a new sample costs one column. invalidate() forces a full redraw.
+template <uint16_t columns, uint8_t column_width, uint8_t height>
+class ColumnChart {
+    static_assert(8 % column_width == 0, "columns must not straddle bytes");
+
+   public:
+    static constexpr uint16_t width = columns * column_width;
+    static constexpr uint16_t stride = (width + 7) >> 3;
+
+    void invalidate() {
+        memset(bitmap, 0, sizeof(bitmap));
+        memset(heights, 0, sizeof(heights));
+    }
+
+    /*!
+        @brief  Update the bitmap to the given column heights (0 - height, clamped)
+        @return Number of redrawn columns
+    */
+    uint16_t update(const uint8_t *new_heights) {
+        uint16_t redrawn = 0;
+
+        for (uint16_t column = 0; column < columns; column++) {
+            const uint8_t h = new_heights[column] > height ? height : new_heights[column];
+            if (h == heights[column]) continue;
+
+            drawColumn(column, h);
+            heights[column] = h;
+            redrawn++;
+        }
+
+        return redrawn;
+    }
+
+    /*!
+        @brief  Draw the chart in black, the background is left untouched
+    */
+    void draw(Adafruit_GFX &gfx, int16_t x, int16_t y) const {
+        gfx.blit(x, y, bitmap, stride, 0, 0, width, height, bitblt::rop_t::clear);
+    }
+
+   private:
+    void drawColumn(uint16_t column, uint8_t h) {
+        const uint16_t x = column * column_width;
+        const uint8_t mask = static_cast<uint8_t>(0xff << (8 - column_width)) >> (x & 0x07);
+        uint8_t *data = bitmap + (x >> 3);
+
+        for (uint8_t yy = 0; yy < height; yy++, data += stride) {
+            if (yy >= height - h)
+                *data |= mask;
+            else
+                *data &= ~mask;
+        }
+    }
+
+   private:
+    uint8_t bitmap[stride * height];
+    uint8_t heights[columns];
+};
+
+#endif  // _COLUMN_CHART_H_
@@ -70,6 +70,33 @@ const uint8_t lut_bb_partial[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 };
 
+// four gray levels, the pixel's bit in the old (0x10) and new (0x13) data selects the waveform
+const uint8_t lut_vcom_gray[] = {
+    0x00, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x60, 0x14, 0x14, 0x00, 0x00, 0x01, 0x00, 0x14, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x13, 0x0A, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+const uint8_t lut_ww_gray[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x90, 0x14, 0x14, 0x00, 0x00, 0x01, 0x10, 0x14,
+    0x0A, 0x00, 0x00, 0x01, 0xA0, 0x13, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+const uint8_t lut_bw_gray[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x90, 0x14, 0x14, 0x00, 0x00, 0x01, 0x00, 0x14,
+    0x0A, 0x00, 0x00, 0x01, 0x99, 0x0C, 0x01, 0x03, 0x04, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+const uint8_t lut_wb_gray[] = {
+    0x40, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x90, 0x14, 0x14, 0x00, 0x00, 0x01, 0x00, 0x14,
+    0x0A, 0x00, 0x00, 0x01, 0x99, 0x0B, 0x04, 0x04, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+const uint8_t lut_bb_gray[] = {
+    0x80, 0x0A, 0x00, 0x00, 0x00, 0x01, 0x90, 0x14, 0x14, 0x00, 0x00, 0x01, 0x20, 0x14,
+    0x0A, 0x00, 0x00, 0x01, 0x50, 0x13, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
 const char* TAG = "display_driver";
 
 spi_device_handle_t display_handle;
@@ -267,6 +294,17 @@ void display_driver::set_mode_partial() {
     current_mode = mode::partial;
 }
 
+void display_driver::set_mode_gray() {
+    if (current_mode == mode::gray) return;
+
+    configure_lut(lut_vcom_gray, lut_ww_gray, lut_bw_gray, lut_wb_gray, lut_bb_gray);
+
+    send_command(0x92);        // disable partial mode
+    send_command(0x50, 0x97);  // white border
+
+    current_mode = mode::gray;
+}
+
 display_driver::mode display_driver::get_mode() { return current_mode; }
 
 void display_driver::turn_off() {
@@ -291,3 +329,8 @@ void display_driver::display_partial(const uint8_t* image_old, const uint8_t* im
 void display_driver::display_partial_old(const uint8_t* image_old) { send_command(0x10, image_old, 300 * 50); }
 
 void display_driver::display_partial_new(const uint8_t* image_new) { send_command(0x13, image_new, 300 * 50); }
+
+void display_driver::display_gray(const uint8_t* plane_old, const uint8_t* plane_new) {
+    send_command(0x10, plane_old, 300 * 50);
+    send_command(0x13, plane_new, 300 * 50);
+}
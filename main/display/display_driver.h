@@ -5,7 +5,7 @@
 
 namespace display_driver {
 
-enum class mode { partial, full, undefined };
+enum class mode { partial, full, gray, undefined };
 
 bool init();
 
@@ -13,6 +13,7 @@ void refresh_display();
 
 void set_mode_full();
 void set_mode_partial();
+void set_mode_gray();
 mode get_mode();
 
 void turn_off();
@@ -22,6 +23,7 @@ void display_full(const uint8_t* image);
 void display_partial(const uint8_t* image_old, const uint8_t* image_new);
 void display_partial_old(const uint8_t* image_old);
 void display_partial_new(const uint8_t* image_new);
+void display_gray(const uint8_t* plane_old, const uint8_t* plane_new);
 
 }  // namespace display_driver
 
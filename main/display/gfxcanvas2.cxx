@@ -0,0 +1,80 @@
+#include "gfxcanvas2.h"
+
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// Every bit of a 1bpp byte widened to a 2bpp pixel mask
+constexpr array<uint16_t, 256> expand = []() {
+    array<uint16_t, 256> table{};
+
+    for (uint16_t i = 0; i < 256; i++)
+        for (uint8_t bit = 0; bit < 8; bit++)
+            if (i & (0x80 >> bit)) table[i] |= 0xc000 >> (2 * bit);
+
+    return table;
+}();
+
+inline uint8_t replicate(gray_t level) { return static_cast<uint8_t>(level) * 0x55; }
+
+}  // namespace
+
+GFXcanvas2::GFXcanvas2() : buffer(make_unique<uint8_t[]>(_size)) { fillScreen(gray_t::white); }
+
+const uint8_t *GFXcanvas2::getBuffer() const { return buffer.get(); }
+
+void GFXcanvas2::drawPixel(int16_t x, int16_t y, gray_t level) {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+
+    uint8_t *data = buffer.get() + y * (_width >> 2) + (x >> 2);
+    const uint8_t shift = 6 - ((x & 0x03) << 1);
+
+    *data = (*data & ~(0x03 << shift)) | (static_cast<uint8_t>(level) << shift);
+}
+
+void GFXcanvas2::fillScreen(gray_t level) { memset(buffer.get(), replicate(level), _size); }
+
+void GFXcanvas2::compose(const Adafruit_GFX &layer, gray_t level) {
+    const uint8_t *src = layer.getBuffer();
+    uint8_t *dst = buffer.get();
+    const uint16_t pattern = replicate(level) * 0x0101;
+
+    for (size_t i = 0; i < _size >> 1; i++, dst += 2) {
+        const uint8_t black = ~src[i];
+        if (!black) continue;
+
+        const uint16_t mask = expand[black];
+        const uint16_t pixels = (((dst[0] << 8) | dst[1]) & ~mask) | (pattern & mask);
+
+        dst[0] = pixels >> 8;
+        dst[1] = pixels;
+    }
+}
+
+void GFXcanvas2::split(uint8_t *plane_old, uint8_t *plane_new) const {
+    const uint8_t *src = buffer.get();
+
+    // 16 pixels per iteration. The pixels' high bits sit at the odd, the low bits at the even positions of the big
+    // endian word; unshuffling moves them into the upper and the lower half respectively.
+    for (size_t i = 0; i < _size; i += 4) {
+        uint32_t x = (static_cast<uint32_t>(src[i]) << 24) | (src[i + 1] << 16) | (src[i + 2] << 8) | src[i + 3];
+        uint32_t t;
+
+        t = (x ^ (x >> 1)) & 0x22222222;
+        x ^= t ^ (t << 1);
+        t = (x ^ (x >> 2)) & 0x0c0c0c0c;
+        x ^= t ^ (t << 2);
+        t = (x ^ (x >> 4)) & 0x00f000f0;
+        x ^= t ^ (t << 4);
+        t = (x ^ (x >> 8)) & 0x0000ff00;
+        x ^= t ^ (t << 8);
+
+        *plane_old++ = x >> 24;
+        *plane_old++ = x >> 16;
+        *plane_new++ = x >> 8;
+        *plane_new++ = x;
+    }
+}
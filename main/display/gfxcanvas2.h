@@ -0,0 +1,46 @@
+#ifndef _GFXCANVAS2_H_
+#define _GFXCANVAS2_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "adagfx.h"
+
+/// Gray levels, the value is the pixel's bit pair (high bit goes to the old, low bit to the new data plane)
+enum class gray_t : uint8_t { black = 0, dark = 1, light = 2, white = 3 };
+
+/// 2bpp canvas for the four gray levels driven by display_driver::set_mode_gray(). Four pixels per byte, leftmost
+/// pixel in the top bits. Content is drawn into 1bpp Adafruit_GFX layers and composed at a gray level.
+class GFXcanvas2 {
+   public:
+    GFXcanvas2();
+
+    const uint8_t *getBuffer() const;
+
+    void drawPixel(int16_t x, int16_t y, gray_t level);
+    void fillScreen(gray_t level);
+
+    /*!
+        @brief  Paint all black pixels of a 1bpp layer with the given gray level. White pixels of the layer are
+                transparent.
+    */
+    void compose(const Adafruit_GFX &layer, gray_t level);
+
+    /*!
+        @brief  Split into the two 1bpp planes sent to the controller (0x10 and 0x13). Each plane takes 300 * 50
+                bytes.
+    */
+    void split(uint8_t *plane_old, uint8_t *plane_new) const;
+
+    int16_t width(void) const { return _width; };
+    int16_t height(void) const { return _height; }
+
+   private:
+    static constexpr int16_t _width = 400;
+    static constexpr int16_t _height = 300;
+    static constexpr size_t _size = _width * _height / 4;
+
+    std::unique_ptr<uint8_t[]> buffer;
+};
+
+#endif  // _GFXCANVAS2_H_
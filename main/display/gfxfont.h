@@ -19,6 +19,10 @@ struct GFXglyph {
     int8_t yOffset;         ///< Y dist from cursor pos to UL corner
 };
 
+/// Set in GFXglyph::bitmapOffset if the glyph bitmap is run-length encoded
+/// (see tools/compress_font.py for the format)
+constexpr uint16_t GFX_GLYPH_RLE = 0x8000;
+
 /// Data stored for FONT AS A WHOLE
 struct GFXfont {
     uint8_t *bitmap;   ///< Glyph bitmaps, concatenated
@@ -0,0 +1,14 @@
+#ifndef _GFXSPRITE_H_
+#define _GFXSPRITE_H_
+
+#include <cstdint>
+
+/// Pre-shifted 1bpp sprite (MSB first, see tools/icon_atlas.py)
+struct GFXsprite {
+    const uint8_t *data;  ///< 8 copies of the image, the copy shifted by n pixels starts at n * height * stride
+    uint8_t width;        ///< Sprite dimensions in pixels
+    uint8_t height;       ///< Sprite dimensions in pixels
+    uint8_t stride;       ///< Bytes per row
+};
+
+#endif  // _GFXSPRITE_H_
@@ -0,0 +1,183 @@
+#include "glyph_cache.h"
+
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_system.h>
+
+#include <cstring>
+
+#include "config.h"
+#include "rle.h"
+
+namespace {
+
+const char* TAG = "glyph_cache";
+
+// Counts are halved every wake, so a use counts USE_WEIGHT in order to survive a few halvings. A cached glyph is only
+// evicted for one that is used more than RESIDENT_BIAS times as often, so that glyphs used equally often do not evict
+// each other depending on the order in which they are drawn.
+constexpr uint16_t USE_WEIGHT = 4;
+constexpr uint16_t RESIDENT_BIAS = 2;
+
+uint16_t add_use(uint16_t uses) { return uses <= UINT16_MAX - USE_WEIGHT ? uses + USE_WEIGHT : UINT16_MAX; }
+
+// Entries are kept in the order of their strikes in the pool, which has no holes
+struct entry_t {
+    const GFXglyph* glyph;
+    uint16_t offset;
+    uint16_t uses;
+};
+
+// Glyphs that missed recently, with how often they did
+struct ghost_t {
+    const GFXglyph* glyph;
+    uint16_t uses;
+};
+
+RTC_NOINIT_ATTR entry_t entries[GLYPH_CACHE_ENTRIES];
+RTC_NOINIT_ATTR ghost_t ghosts[GLYPH_CACHE_GHOSTS];
+RTC_NOINIT_ATTR uint8_t pool[GLYPH_CACHE_SIZE];
+
+RTC_NOINIT_ATTR glyph_cache::stats_t stats;
+
+static_assert(sizeof(entries) + sizeof(ghosts) + sizeof(pool) + sizeof(stats) ==
+              glyph_cache::rtc_bytes(GLYPH_CACHE_SIZE, GLYPH_CACHE_ENTRIES, GLYPH_CACHE_GHOSTS));
+
+uint16_t strike_size(const GFXglyph* glyph) { return ((glyph->width + 7) >> 3) * glyph->height; }
+
+void decode(const GFXfont* font, const GFXglyph* glyph, uint8_t* strike) {
+    const uint8_t stride = (glyph->width + 7) >> 3;
+    memset(strike, 0, stride * glyph->height);
+
+    if (glyph->bitmapOffset & GFX_GLYPH_RLE) {
+        rle::decode(font->bitmap + (glyph->bitmapOffset & ~GFX_GLYPH_RLE), glyph->width, glyph->height,
+                    [&](uint8_t xx, uint8_t yy, uint8_t run) {
+                        uint8_t* row = strike + yy * stride;
+                        for (uint8_t i = xx; i < xx + run; i++) row[i >> 3] |= 0x80 >> (i & 0x07);
+                    });
+
+        return;
+    }
+
+    const uint8_t* bitmap = font->bitmap + glyph->bitmapOffset;
+    uint16_t bit = 0;
+
+    for (uint8_t yy = 0; yy < glyph->height; yy++) {
+        uint8_t* row = strike + yy * stride;
+
+        for (uint8_t xx = 0; xx < glyph->width; xx++, bit++)
+            if (bitmap[bit >> 3] & (0x80 >> (bit & 0x07))) row[xx >> 3] |= 0x80 >> (xx & 0x07);
+    }
+}
+
+// Counts a miss, the ghost of the least used glyph is replaced if there is none for this one yet
+ghost_t& count_miss(const GFXglyph* glyph) {
+    ghost_t* ghost = ghosts;
+
+    for (ghost_t& candidate : ghosts) {
+        if (candidate.glyph == glyph) {
+            ghost = &candidate;
+            break;
+        }
+
+        if (candidate.uses < ghost->uses) ghost = &candidate;
+    }
+
+    if (ghost->glyph != glyph) *ghost = {.glyph = glyph, .uses = 0};
+    ghost->uses = add_use(ghost->uses);
+
+    return *ghost;
+}
+
+uint16_t least_used() {
+    uint16_t victim = 0;
+
+    for (uint16_t i = 1; i < stats.entries; i++)
+        if (entries[i].uses < entries[victim].uses) victim = i;
+
+    return victim;
+}
+
+// Removes the entry and closes the gap in the pool, the evicted glyph keeps its count as ghost
+void evict(uint16_t index) {
+    const uint16_t offset = entries[index].offset;
+    const uint16_t size = strike_size(entries[index].glyph);
+
+    ghost_t& ghost = count_miss(entries[index].glyph);
+    ghost.uses = entries[index].uses;
+
+    memmove(pool + offset, pool + offset + size, stats.bytes_used - offset - size);
+    memmove(entries + index, entries + index + 1, (stats.entries - index - 1) * sizeof(entry_t));
+
+    stats.entries--;
+    stats.bytes_used -= size;
+
+    for (uint16_t i = index; i < stats.entries; i++) entries[i].offset -= size;
+}
+
+// Whether evicting the entries the candidate outweighs frees enough space
+bool can_admit(uint16_t size, uint16_t uses) {
+    if (size > GLYPH_CACHE_SIZE) return false;
+
+    uint32_t space = GLYPH_CACHE_SIZE - stats.bytes_used;
+    uint16_t free_entries = GLYPH_CACHE_ENTRIES - stats.entries;
+
+    for (uint16_t i = 0; i < stats.entries; i++) {
+        if (static_cast<uint32_t>(entries[i].uses) * RESIDENT_BIAS >= uses) continue;
+
+        space += strike_size(entries[i].glyph);
+        free_entries++;
+    }
+
+    return space >= size && free_entries > 0;
+}
+
+}  // namespace
+
+void glyph_cache::init() {
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP) {
+        // Counts decay by half every wake, glyphs that are no longer drawn make room within a few cycles
+        for (uint16_t i = 0; i < stats.entries; i++) entries[i].uses >>= 1;
+        for (ghost_t& ghost : ghosts) ghost.uses >>= 1;
+
+        return;
+    }
+
+    ESP_LOGI(TAG, "hard reset, clearing glyph cache");
+
+    stats = {.hits = 0, .misses = 0, .entries = 0, .bytes_used = 0};
+    for (ghost_t& ghost : ghosts) ghost = {.glyph = nullptr, .uses = 0};
+}
+
+const uint8_t* glyph_cache::lookup(const GFXfont* font, const GFXglyph* glyph) {
+    for (uint16_t i = 0; i < stats.entries; i++) {
+        if (entries[i].glyph != glyph) continue;
+
+        stats.hits++;
+        entries[i].uses = add_use(entries[i].uses);
+
+        return pool + entries[i].offset;
+    }
+
+    stats.misses++;
+
+    ghost_t& ghost = count_miss(glyph);
+    const uint16_t uses = ghost.uses;
+    const uint16_t size = strike_size(glyph);
+
+    if (!can_admit(size, uses)) return nullptr;
+
+    ghost = {.glyph = nullptr, .uses = 0};
+
+    while (stats.entries == GLYPH_CACHE_ENTRIES || stats.bytes_used + size > GLYPH_CACHE_SIZE) evict(least_used());
+
+    entry_t& entry = entries[stats.entries++];
+    entry = {.glyph = glyph, .offset = stats.bytes_used, .uses = uses};
+
+    decode(font, glyph, pool + entry.offset);
+    stats.bytes_used += size;
+
+    return pool + entry.offset;
+}
+
+glyph_cache::stats_t glyph_cache::get_stats() { return stats; }
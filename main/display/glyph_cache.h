@@ -0,0 +1,36 @@
+#ifndef _GLYPH_CACHE_H_
+#define _GLYPH_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gfxfont.h"
+
+// Cache for decoded glyph strikes (rows padded to whole bytes, MSB first). The cache lives in RTC memory, so the
+// glyphs drawn every cycle are not fetched from flash again. It holds the most frequently drawn glyphs: use counts
+// decay every wake, and a glyph that misses only displaces glyphs drawn much less often.
+namespace glyph_cache {
+
+struct stats_t {
+    uint32_t hits;
+    uint32_t misses;
+    uint16_t entries;
+    uint16_t bytes_used;
+};
+
+// RTC memory taken by a cache of the given GLYPH_CACHE_SIZE, GLYPH_CACHE_ENTRIES and GLYPH_CACHE_GHOSTS: the pool,
+// the entries and ghosts (a glyph pointer and counts each) and the stats
+constexpr size_t rtc_bytes(size_t size, size_t entries, size_t ghosts) {
+    return size + (entries + ghosts) * 2 * sizeof(void*) + sizeof(stats_t);
+}
+
+void init();
+
+// The strike is valid until the next lookup, nullptr if the glyph is not cached
+const uint8_t* lookup(const GFXfont* font, const GFXglyph* glyph);
+
+stats_t get_stats();
+
+}  // namespace glyph_cache
+
+#endif  // _GLYPH_CACHE_H_
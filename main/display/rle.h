@@ -0,0 +1,58 @@
+#ifndef _RLE_H_
+#define _RLE_H_
+
+#include <cstdint>
+
+namespace rle {
+
+// Decode a single row of a run-length encoded glyph (see tools/compress_font.py). Calls span(xx, run) for every run
+// of set pixels and returns a pointer to the first token after the row.
+template <typename T>
+const uint8_t* decode_row(const uint8_t* data, uint8_t w, T span) {
+    uint8_t token = *data++;
+    uint8_t xx = (token >> 4) - 1;
+
+    while (true) {
+        const uint8_t run = token & 0x0f;
+        if (run > 0) span(xx, run);
+
+        xx += run;
+        if (xx >= w) break;
+
+        token = *data++;
+        if (token == 0) break;
+
+        xx += token >> 4;
+    }
+
+    return data;
+}
+
+// Decode a run-length encoded glyph. Calls span(xx, yy, run) for every run of set pixels. Repeated rows are replayed
+// from the tokens of the previous row.
+template <typename T>
+void decode(const uint8_t* data, uint8_t w, uint8_t h, T span) {
+    const uint8_t* previous_row = data;
+
+    for (uint8_t yy = 0; yy < h;) {
+        const uint8_t token = *data;
+
+        if (token == 0) {
+            data++;
+            yy++;
+        } else if (token < 0x10) {
+            data++;
+
+            for (uint8_t i = 0; i < token; i++, yy++)
+                decode_row(previous_row, w, [&](uint8_t xx, uint8_t run) { span(xx, yy, run); });
+        } else {
+            previous_row = data;
+            data = decode_row(data, w, [&](uint8_t xx, uint8_t run) { span(xx, yy, run); });
+            yy++;
+        }
+    }
+}
+
+}  // namespace rle
+
+#endif  // _RLE_H_
@@ -1,6 +1,9 @@
 #include "display_task.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+
+#include <memory>
 
 // clang-format off
 #include "freertos/FreeRTOS.h"
@@ -8,6 +11,8 @@
 
 #include "config.h"
 #include "display/display_driver.h"
+#include "display/gfxcanvas2.h"
+#include "display/glyph_cache.h"
 #include "freertos/event_groups.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
@@ -23,9 +28,40 @@ TaskHandle_t task_handle;
 QueueHandle_t queue_handle;
 EventGroupHandle_t event_group_handle;
 
-void task_main(void*) {
-    display_driver::init();
+#if DISPLAY_GRAYSCALE
+void display_gray(const view::model_t& model) {
+    std::unique_ptr<uint8_t[]> planes;
+
+    {
+        GFXcanvas2 canvas;
+
+        {
+            Adafruit_GFX gfx;
+            Adafruit_GFX gray_layer;
+
+            view::render(gfx, model, &gray_layer);
+
+            canvas.compose(gfx, gray_t::black);
+            canvas.compose(gray_layer, gray_t::dark);
+        }
+
+        const int64_t timestamp = esp_timer_get_time();
+
+        planes = std::make_unique<uint8_t[]>(2 * 300 * 50);
+        canvas.split(planes.get(), planes.get() + 300 * 50);
 
+        ESP_LOGI(TAG, "bit-plane split took %lli usec", esp_timer_get_time() - timestamp);
+    }
+
+    display_driver::display_gray(planes.get(), planes.get() + 300 * 50);
+}
+#endif
+
+void prepare_update() {
+#if DISPLAY_GRAYSCALE
+    ESP_LOGI(TAG, "performing grayscale update");
+    display_driver::set_mode_gray();
+#else
     if (persistence::view_counter == 0) {
         ESP_LOGI(TAG, "performing full update");
         display_driver::set_mode_full();
@@ -39,14 +75,13 @@ void task_main(void*) {
 
         display_driver::display_partial_old(gfx.getBuffer());
     }
+#endif
+}
 
-    ESP_LOGI(TAG, "display driver initialized, waiting for view data");
-
-    view::model_t model;
-    xQueueReceive(queue_handle, &model, portMAX_DELAY);
-
-    ESP_LOGI(TAG, "received view data, rendering to display");
-
+void update(const view::model_t& model) {
+#if DISPLAY_GRAYSCALE
+    display_gray(model);
+#else
     Adafruit_GFX gfx;
 
     view::render(gfx, model);
@@ -55,15 +90,46 @@ void task_main(void*) {
         display_driver::display_full(gfx.getBuffer());
     else
         display_driver::display_partial_new(gfx.getBuffer());
+#endif
 
     display_driver::refresh_display();
     persistence::view_counter = (persistence::view_counter + 1) % FULL_REFRESH_EVERY_CYCLE;
+}
 
-    display_driver::turn_off();
+void task_main(void*) {
+    glyph_cache::init();
+    view::init();
+    display_driver::init();
 
-    ESP_LOGI(TAG, "done");
+    // The first update is prepared while the network is being set up
+    prepare_update();
+
+    ESP_LOGI(TAG, "display driver initialized, waiting for view data");
+
+    view::model_t model;
 
-    xEventGroupSetBits(event_group_handle, event_bit::display_complete);
+    for (bool first = true;; first = false) {
+        xQueueReceive(queue_handle, &model, portMAX_DELAY);
+
+        ESP_LOGI(TAG, "received view data, rendering to display");
+
+        if (!first) {
+            display_driver::turn_on();
+            prepare_update();
+        }
+
+        update(model);
+
+        display_driver::turn_off();
+
+        ESP_LOGI(TAG, "done");
+
+        xEventGroupSetBits(event_group_handle, event_bit::display_complete);
+
+#if !CONTINUOUS_MODE
+        break;
+#endif
+    }
 
     vTaskDelete(nullptr);
 }
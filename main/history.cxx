@@ -0,0 +1,102 @@
+#include "history.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+
+using namespace std;
+
+namespace {
+
+const char* TAG = "history";
+
+uint16_t clamp_w(float power) { return min(max(lroundf(power), 0L), static_cast<long>(history::NO_DATA - 1)); }
+
+// Running mean over the readings of the current slot
+uint16_t average(uint16_t mean, uint16_t samples, uint16_t value) {
+    return (static_cast<uint32_t>(mean) * samples + value) / (samples + 1);
+}
+
+}  // namespace
+
+void history::clear(day_t& history) {
+    history.day = -1;
+    history.slot = 0;
+    history.slot_samples = 0;
+
+    fill_n(history.pv_w, SLOTS, NO_DATA);
+    fill_n(history.load_w, SLOTS, NO_DATA);
+}
+
+void history::record(day_t& history, uint64_t epoch, float pv_w, float load_w) {
+    if (pv_w < 0 || load_w < 0) return;
+
+    time_t time = epoch;
+    struct tm local;
+
+    if (!localtime_r(&time, &local)) {
+        ESP_LOGE(TAG, "localtime failed: %i", errno);
+        return;
+    }
+
+    const int32_t day = local.tm_year * 366 + local.tm_yday;
+    const uint16_t slot = (local.tm_hour * 60 + local.tm_min) / HISTORY_SLOT_MINUTES;
+
+    if (day != history.day) {
+        clear(history);
+        history.day = day;
+    }
+
+    if (slot != history.slot || history.pv_w[slot] == NO_DATA) {
+        history.slot = slot;
+        history.slot_samples = 0;
+    }
+
+    history.pv_w[slot] = average(history.pv_w[slot], history.slot_samples, clamp_w(pv_w));
+    history.load_w[slot] = average(history.load_w[slot], history.slot_samples, clamp_w(load_w));
+
+    history.slot_samples++;
+}
+
+void history::add(day_t& history, const day_t& other) {
+    if (history.day != other.day) {
+        clear(history);
+        return;
+    }
+
+    for (uint16_t i = 0; i < SLOTS; i++) {
+        if (history.pv_w[i] == NO_DATA || other.pv_w[i] == NO_DATA) {
+            history.pv_w[i] = history.load_w[i] = NO_DATA;
+            continue;
+        }
+
+        history.pv_w[i] = min(history.pv_w[i] + other.pv_w[i], NO_DATA - 1);
+        history.load_w[i] = min(history.load_w[i] + other.load_w[i], NO_DATA - 1);
+    }
+}
+
+void history::merge(day_t& history, const day_t& backfill) {
+    if (backfill.day < 0 || backfill.day < history.day) return;
+
+    if (history.day < backfill.day) {
+        ESP_LOGI(TAG, "replacing history with backfill");
+
+        history = backfill;
+        return;
+    }
+
+    uint16_t filled = 0;
+
+    for (uint16_t i = 0; i < SLOTS; i++) {
+        if (history.pv_w[i] != NO_DATA || backfill.pv_w[i] == NO_DATA) continue;
+
+        history.pv_w[i] = backfill.pv_w[i];
+        history.load_w[i] = backfill.load_w[i];
+        filled++;
+    }
+
+    ESP_LOGI(TAG, "backfilled %u slots", filled);
+}
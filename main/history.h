@@ -0,0 +1,36 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <cstdint>
+
+#include "config.h"
+
+// Intraday PV and load curve, one slot per HISTORY_SLOT_MINUTES of local time. Readings that fall into the same slot
+// are averaged.
+namespace history {
+
+constexpr uint16_t SLOTS = 24 * 60 / HISTORY_SLOT_MINUTES;
+constexpr uint16_t NO_DATA = 0xffff;
+
+struct day_t {
+    int32_t day;  // local date (tm_year * 366 + tm_yday), -1 if empty
+    uint16_t slot;
+    uint16_t slot_samples;
+
+    uint16_t pv_w[SLOTS];
+    uint16_t load_w[SLOTS];
+};
+
+void clear(day_t& history);
+
+void record(day_t& history, uint64_t epoch, float pv_w, float load_w);
+
+// Adds up the curves of two systems, slots missing in either of them are missing in the sum
+void add(day_t& history, const day_t& other);
+
+// Fills the slots without readings from a backfilled curve of the same day, replaces the history of an older day
+void merge(day_t& history, const day_t& backfill);
+
+}  // namespace history
+
+#endif  // _HISTORY_H_
@@ -2,32 +2,66 @@
 
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <http_parser.h>
+#include <lwip/inet.h>
+#include <lwip/sockets.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ssl.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <cstring>
 
 #include "esp_crt_bundle.h"
+#include "http2_io.h"
 
 using namespace std;
 
 namespace {
 const char* TAG = "http2_connection";
+
+bool is_retryable(int32_t http_status) { return http_status >= 500; }
+
+// The bundle attach hook has no context argument, so the connection that is currently connecting is stashed here.
+// Handshakes are serialized by connect_mutex() to keep it unambiguous.
+Http2Connection* connecting = nullptr;
+
+SemaphoreHandle_t connect_mutex() {
+    static const SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    return mutex;
 }
+}  // namespace
 
 int Http2Connection::receive_cb(struct sh2lib_handle* handle, void* context, int stream_id, const char* data,
                                 size_t len, int flags) {
     Http2Request* request = reinterpret_cast<Http2Request*>(context);
+    Http2Connection* self = request->connection;
 
-    const size_t bytes_to_copy = min(len, request->max_len - request->len - 1);
-    if (bytes_to_copy < len) ESP_LOGE(TAG, "request buffer overflow on stream %i", stream_id);
-
-    memcpy(request->data.get() + request->len, data, bytes_to_copy);
-    request->len += bytes_to_copy;
+    const int attempt = attemptOf(request, stream_id);
+    if (attempt < 0) return 0;
 
     if (flags == DATA_RECV_RST_STREAM) {
-        request->state = Http2Request::State::complete;
-        request->data[request->len] = '\0';
-        request->connection->pending_streams--;
+        if (attempt == request->owner) {
+            self->completeRequest(request, Http2Request::State::complete);
+        } else {
+            // reset by the server before responding
+            self->dropAttempt(request, attempt);
+        }
+
+        return 0;
+    }
+
+    if (attempt != request->owner) return 0;
+
+    if (request->data_cb) {
+        if (len > 0) request->data_cb(request->data_cb_context, data, len);
+        request->len += len;
+    } else {
+        const size_t bytes_to_copy = min(len, request->max_len - request->len - 1);
+        if (bytes_to_copy < len) ESP_LOGE(TAG, "request buffer overflow on stream %i", stream_id);
+
+        memcpy(request->data.get() + request->len, data, bytes_to_copy);
+        request->len += bytes_to_copy;
     }
 
     return 0;
@@ -36,10 +70,36 @@ int Http2Connection::receive_cb(struct sh2lib_handle* handle, void* context, int
 int Http2Connection::header_cb(struct sh2lib_handle* handle, void* context, int stream_id, const char* name,
                                size_t name_len, const char* value, size_t value_len) {
     Http2Request* request = reinterpret_cast<Http2Request*>(context);
+    Http2Connection* self = request->connection;
+
+    const int attempt = attemptOf(request, stream_id);
+    if (attempt < 0) return 0;
+
+    if (request->owner < 0 && strcmp(":status", name) == 0) {
+        const int32_t http_status = atoi(value);
 
-    if (strcmp(":status", name) == 0) {
-        request->http_status = atoi(value);
-    } else if (strcmp("date", name) == 0) {
+        if (is_retryable(http_status) && self->canRetry(request)) {
+            ESP_LOGW(TAG, "stream %i failed with HTTP status %li, retrying", stream_id, http_status);
+
+            request->rejected_status = http_status;
+            sh2lib_cancel(&self->handle, stream_id);
+            self->dropAttempt(request, attempt);
+
+            return 0;
+        }
+
+        request->owner = attempt;
+        request->http_status = http_status;
+
+        if (self->latency) self->latency->update((esp_timer_get_time() - request->attempt_timestamps[attempt]) / 1000);
+
+        for (int other = 0; other < request->attempts; other++) {
+            if (other == attempt || !request->attempt_active[other]) continue;
+
+            sh2lib_cancel(&self->handle, request->stream_ids[other]);
+            request->attempt_active[other] = false;
+        }
+    } else if (attempt == request->owner && strcmp("date", name) == 0) {
         strncpy(request->date, value, Http2Request::MAX_DATE_LEN);
         request->date[Http2Request::MAX_DATE_LEN - 1] = '\0';
     }
@@ -47,63 +107,495 @@ int Http2Connection::header_cb(struct sh2lib_handle* handle, void* context, int
     return 0;
 }
 
-Http2Connection::Http2Connection(const char* server_url) : server_url(server_url) {}
+int Http2Connection::attemptOf(const Http2Request* request, int stream_id) {
+    for (int attempt = 0; attempt < request->attempts; attempt++)
+        if (request->stream_ids[attempt] == stream_id) return attempt;
+
+    return -1;
+}
+
+esp_err_t Http2Connection::crt_bundle_attach(void* conf) {
+    const esp_err_t result = esp_crt_bundle_attach(conf);
+    if (result != ESP_OK || !connecting || !connecting->tls_cache || connecting->pin_depth < 0) return result;
+
+    mbedtls_ssl_config* ssl_config = reinterpret_cast<mbedtls_ssl_config*>(conf);
+
+    connecting->bundle_verify = ssl_config->MBEDTLS_PRIVATE(f_vrfy);
+    connecting->bundle_verify_context = ssl_config->MBEDTLS_PRIVATE(p_vrfy);
+    mbedtls_ssl_conf_verify(ssl_config, verify_cb, connecting);
+
+    return ESP_OK;
+}
+
+int Http2Connection::verify_cb(void* context, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    Http2Connection* self = reinterpret_cast<Http2Connection*>(context);
+    uint8_t hash[32];
+
+    if (depth == self->pin_depth) mbedtls_sha256(crt->pk_raw.p, crt->pk_raw.len, hash, 0);
+
+    if (self->tls_cache->pin_depth != self->pin_depth) {
+        if (depth == self->pin_depth) {
+            memcpy(self->pin_candidate, hash, sizeof(hash));
+            self->pin_candidate_set = true;
+        }
+
+        return self->bundle_verify(self->bundle_verify_context, crt, depth, flags);
+    }
+
+    // The chain is verified top down, so trust in the top certificate (which has no trusted parent without the
+    // bundle) is granted before the pinned certificate has been seen. Lower certificates keep their flags, a bad
+    // signature is reported there. If the pin is not confirmed by the time the leaf is verified, the handshake fails.
+    self->pin_used = true;
+
+    if (depth >= self->chain_top_depth) {
+        self->chain_top_depth = depth;
+        self->pin_confirmed = false;
+        *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    }
+
+    if (depth == self->pin_depth) self->pin_confirmed = memcmp(hash, self->tls_cache->pin, sizeof(hash)) == 0;
+
+    if (depth == 0 && !self->pin_confirmed) *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+
+    return 0;
+}
+
+Http2Connection::Http2Connection(const char* server_url, Http2TlsCache* tls_cache, int8_t pin_depth)
+    : server_url(server_url), tls_cache(tls_cache), pin_depth(pin_depth) {}
+
+Http2Connection::~Http2Connection() {
+    disconnect();
+
+    if (mutex) vSemaphoreDelete(mutex);
+    if (event_group) vEventGroupDelete(event_group);
+}
+
+int Http2Connection::connectOnce(uint32_t timeout, const char* uri, const char* common_name) {
+    const bool resume = tls_cache && tls_cache->session_size > 0;
 
-Http2Connection::Status Http2Connection::connect(uint32_t timeout) {
-    sh2lib_config_t config = {.uri = server_url, .crt_bundle_attach = esp_crt_bundle_attach};
+    sh2lib_config_t config = {.uri = uri,
+                              .crt_bundle_attach = crt_bundle_attach,
+                              .common_name = common_name,
+                              .session_buf = resume ? tls_cache->session : nullptr,
+                              .session_bytes = resume ? tls_cache->session_size : 0};
 
-    ESP_LOGI(TAG, "connecting to %s", server_url);
+    pin_used = pin_confirmed = pin_candidate_set = false;
+    chain_top_depth = -1;
 
-    if (sh2lib_connect(&config, &handle, timeout) != ESP_OK) return Status::failed;
+    xSemaphoreTake(connect_mutex(), portMAX_DELAY);
+    connecting = this;
+    const int result = sh2lib_connect(&config, &handle, timeout);
+    connecting = nullptr;
+    xSemaphoreGive(connect_mutex());
+
+    return result;
+}
+
+Http2Connection::Status Http2Connection::connect(uint32_t timeout, uint32_t address) {
+    const char* uri = server_url;
+    char address_uri[32];
+    char common_name[128];
+
+    if (address != 0) {
+        http_parser_url url;
+        http_parser_url_init(&url);
+
+        if (http_parser_parse_url(server_url, strlen(server_url), 0, &url) != 0 ||
+            url.field_data[UF_HOST].len >= sizeof(common_name)) {
+            ESP_LOGE(TAG, "unable to parse %s", server_url);
+            return Status::failed;
+        }
+
+        memcpy(common_name, server_url + url.field_data[UF_HOST].off, url.field_data[UF_HOST].len);
+        common_name[url.field_data[UF_HOST].len] = '\0';
+
+        char address_formatted[16];
+        in_addr addr = {.s_addr = address};
+        inet_ntoa_r(addr, address_formatted, sizeof(address_formatted));
+
+        snprintf(address_uri, sizeof(address_uri), "https://%s:%u", address_formatted,
+                 (url.field_set & (1 << UF_PORT)) ? url.port : 443);
+        uri = address_uri;
+    }
+
+    const char* resume_note = tls_cache && tls_cache->session_size > 0 ? " (resuming TLS session)" : "";
+
+    if (address != 0)
+        ESP_LOGI(TAG, "connecting to %s at cached address %s%s", server_url, uri, resume_note);
+    else
+        ESP_LOGI(TAG, "connecting to %s%s", server_url, resume_note);
+
+    const char* server_name = address != 0 ? common_name : nullptr;
+    const int64_t timestamp = esp_timer_get_time();
+    int result = connectOnce(timeout, uri, server_name);
+    bool session_rejected = handle.session_rejected;
+
+    if (result != ESP_OK && pin_used) {
+        tls_cache->pin_depth = -1;
+
+        // the retry gets what is left of the timeout, the pin is dropped either way
+        const int64_t left = static_cast<int64_t>(timeout) - (esp_timer_get_time() - timestamp) / 1000;
+
+        if (left > 0) {
+            ESP_LOGW(TAG, "certificate pin did not match, retrying with CA bundle verification");
+
+            result = connectOnce(left, uri, server_name);
+            session_rejected |= handle.session_rejected;
+        }
+    }
+
+    if (result != ESP_OK) {
+        // a stale address or an unreachable server says nothing about the session, it is kept for the next attempt
+        if (tls_cache && session_rejected) tls_cache->session_size = 0;
+        return Status::failed;
+    }
+
+    ESP_LOGI(TAG, "connected after %lli msec%s", (esp_timer_get_time() - timestamp) / 1000,
+             pin_used ? " (certificate pin matched)" : "");
+
+    if (tls_cache) {
+        const size_t capacity = sizeof(tls_cache->session);
+        if (sh2lib_save_session(&handle, tls_cache->session, capacity, &tls_cache->session_size) != 0)
+            tls_cache->session_size = 0;
+
+        if (pin_candidate_set) {
+            ESP_LOGI(TAG, "pinning certificate at chain depth %i", pin_depth);
+
+            memcpy(tls_cache->pin, pin_candidate, sizeof(pin_candidate));
+            tls_cache->pin_depth = pin_depth;
+        }
+    }
+
+    // created here rather than in the constructor, connections may be static
+    if (!mutex) mutex = xSemaphoreCreateMutex();
+    if (!event_group) event_group = xEventGroupCreate();
+
+    sh2lib_get_sockfd(&handle, &socket);
 
     connected = true;
+    failed = false;
+    session++;
+    pending_request_count = 0;
+    fill(begin(pending_requests), end(pending_requests), nullptr);
+    ping_acks = 0;
+
+    xEventGroupClearBits(event_group, connection_failed | ping_ack);
+    xEventGroupSetBits(event_group, streams_done);
+
+    if (!http2_io::attach(this)) {
+        sh2lib_free(&handle);
+        connected = false;
+
+        return Status::failed;
+    }
+
     return Status::done;
 }
 
+uint32_t Http2Connection::getPeerAddress() {
+    if (!connected) return 0;
+
+    int sockfd;
+    if (sh2lib_get_sockfd(&handle, &sockfd) != ESP_OK) return 0;
+
+    sockaddr_storage peer;
+    socklen_t len = sizeof(peer);
+
+    if (getpeername(sockfd, reinterpret_cast<sockaddr*>(&peer), &len) != 0 || peer.ss_family != AF_INET) return 0;
+
+    return reinterpret_cast<sockaddr_in*>(&peer)->sin_addr.s_addr;
+}
+
 void Http2Connection::disconnect() {
     if (!connected) return;
 
+    http2_io::detach(this);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
     sh2lib_free(&handle);
     connected = false;
+    socket = -1;
+    pending_request_count = 0;
+    fill(begin(pending_requests), end(pending_requests), nullptr);
+
+    xSemaphoreGive(mutex);
+}
+
+bool Http2Connection::isConnected() const { return connected; }
+
+Http2Connection::Status Http2Connection::ping(uint32_t timeout) {
+    if (!connected) return Status::failed;
+
+    const int64_t timestamp = esp_timer_get_time();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    xEventGroupClearBits(event_group, ping_ack);
+    const int result = failed ? -1 : sh2lib_ping(&handle);
+
+    xSemaphoreGive(mutex);
+
+    if (result != 0) {
+        disconnect();
+        return Status::failed;
+    }
+
+    http2_io::wake();
+
+    const EventBits_t bits =
+        xEventGroupWaitBits(event_group, ping_ack | connection_failed, pdFALSE, pdFALSE, timeout / portTICK_PERIOD_MS);
+
+    if ((bits & ping_ack) == 0) {
+        ESP_LOGW(TAG, "PING %s, closing connection", (bits & connection_failed) ? "failed" : "timeout");
+        disconnect();
+
+        return (bits & connection_failed) ? Status::failed : Status::timeout;
+    }
+
+    ESP_LOGI(TAG, "PING round trip took %lli msec", (esp_timer_get_time() - timestamp) / 1000);
+
+    return Status::done;
+}
+
+void Http2Connection::enableRetries(uint8_t max_attempts, Http2LatencyEstimate* latency, uint32_t min_hedge_delay) {
+    this->max_attempts = min(max(max_attempts, static_cast<uint8_t>(1)), Http2Request::MAX_ATTEMPTS);
+    this->latency = latency;
+    this->min_hedge_delay = min_hedge_delay;
 }
 
 void Http2Connection::addRequest(const char* url, Http2Request* request, const Http2Header* headers,
-                                 size_t header_count) {
+                                 size_t header_count, bool hedge) {
     if (!connected) return;
 
-    nghttp2_nv nva[4 + header_count] = {
+    strncpy(request->path, url, Http2Request::MAX_PATH_LEN);
+    request->path[Http2Request::MAX_PATH_LEN - 1] = '\0';
+    request->headers = headers;
+    request->header_count = header_count;
+    request->hedge = hedge;
+
+    request->callback_context = {.frame_data_recv_cb = receive_cb, .header_cb = header_cb, .context = request};
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    Http2Request** slot = find(begin(pending_requests), end(pending_requests), nullptr);
+
+    if (slot == end(pending_requests)) {
+        ESP_LOGE(TAG, "too many pending requests");
+    } else if (!failed) {
+        request->connection = this;
+        request->session = session;
+        request->attempts = 0;
+        request->owner = -1;
+
+        if (submitAttempt(request) > 0) {
+            *slot = request;
+
+            pending_request_count++;
+            xEventGroupClearBits(event_group, streams_done);
+        }
+    }
+
+    xSemaphoreGive(mutex);
+
+    http2_io::wake();
+}
+
+int Http2Connection::submitAttempt(Http2Request* request) {
+    nghttp2_nv nva[4 + request->header_count] = {
         SH2LIB_MAKE_NV(":method", "GET"),
         SH2LIB_MAKE_NV(":scheme", "https"),
         SH2LIB_MAKE_NV(":authority", handle.hostname),
-        SH2LIB_MAKE_NV(":path", url),
+        SH2LIB_MAKE_NV(":path", request->path),
     };
 
-    for (int i = 0; i < header_count; i++) {
-        nva[4 + i] = SH2LIB_MAKE_NV(headers[i].name, headers[i].value);
+    for (int i = 0; i < request->header_count; i++) {
+        nva[4 + i] = SH2LIB_MAKE_NV(request->headers[i].name, request->headers[i].value);
     }
-    request->callback_context = {.frame_data_recv_cb = receive_cb, .header_cb = header_cb, .context = request};
-    request->connection = this;
 
-    sh2lib_do_get_with_nv(&handle, nva, header_count + 4, &request->callback_context);
-    pending_streams++;
+    const int stream_id = sh2lib_do_get_with_nv(&handle, nva, request->header_count + 4, &request->callback_context);
+    if (stream_id <= 0) return stream_id;
+
+    const uint8_t attempt = request->attempts++;
+
+    request->stream_ids[attempt] = stream_id;
+    request->attempt_timestamps[attempt] = esp_timer_get_time();
+    request->attempt_active[attempt] = true;
+
+    return stream_id;
+}
+
+void Http2Connection::dropAttempt(Http2Request* request, int attempt) {
+    request->attempt_active[attempt] = false;
+
+    for (int i = 0; i < request->attempts; i++)
+        if (request->attempt_active[i]) return;
+
+    if (canRetry(request)) {
+        xEventGroupSetBits(event_group, attempt_failed);
+    } else {
+        request->http_status = request->rejected_status;
+        completeRequest(request, Http2Request::State::complete);
+    }
+}
+
+bool Http2Connection::canRetry(const Http2Request* request) const { return request->attempts < max_attempts; }
+
+// Returns the time of the next hedge (esp_timer_get_time() scale), INT64_MAX if there is none
+int64_t Http2Connection::issueDueAttempts(int64_t now, uint32_t timeout) {
+    const int64_t hedge_delay =
+        1000ll * (latency && latency->samples > 0
+                      ? max(min_hedge_delay, static_cast<uint32_t>(latency->mean_ms + 4 * latency->deviation_ms))
+                      : max(min_hedge_delay, timeout / 2));
+
+    int64_t next_hedge = INT64_MAX;
+
+    for (Http2Request* request : pending_requests) {
+        if (!request || request->owner >= 0 || !canRetry(request)) continue;
+
+        const bool active = find(request->attempt_active, request->attempt_active + request->attempts, true) !=
+                            request->attempt_active + request->attempts;
+        if (active && !request->hedge) continue;
+
+        const int64_t due = active ? request->attempt_timestamps[request->attempts - 1] + hedge_delay : now;
+
+        if (due > now) {
+            next_hedge = min(next_hedge, due);
+            continue;
+        }
+
+        ESP_LOGW(TAG, "%s %s after %lli msec", active ? "hedging" : "retrying", request->path,
+                 (now - request->attempt_timestamps[0]) / 1000);
+
+        if (submitAttempt(request) > 0 && request->hedge && canRetry(request))
+            next_hedge = min(next_hedge, request->attempt_timestamps[request->attempts - 1] + hedge_delay);
+    }
+
+    return next_hedge;
+}
+
+void Http2Connection::cancel(Http2Request* request) {
+    if (!mutex) return;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (request->connection == this && request->state == Http2Request::State::pending) {
+        // A request that has been issued on an earlier session is just released
+        if (connected && request->session == session) {
+            completeRequest(request, Http2Request::State::cancelled);
+            ESP_LOGI(TAG, "cancelled request for %s", request->path);
+        } else {
+            request->state = Http2Request::State::cancelled;
+        }
+    }
+
+    xSemaphoreGive(mutex);
+
+    http2_io::wake();
 }
 
 Http2Connection::Status Http2Connection::executePendingRequests(uint32_t timeout) {
-    uint64_t timestamp = esp_timer_get_time();
+    if (!connected) return Status::failed;
+
+    const int64_t deadline = esp_timer_get_time() + 1000ll * timeout;
 
-    while (pending_streams > 0) {
-        int64_t remaining = timeout * 1000 - esp_timer_get_time() + timestamp;
+    for (;;) {
+        const int64_t now = esp_timer_get_time();
 
-        if (remaining <= 0) {
+        if (now >= deadline) {
             ESP_LOGE(TAG, "request timeout");
             return Status::timeout;
         }
 
-        if (sh2lib_execute_sync(&handle, remaining / 1000) != 0) {
+        xEventGroupClearBits(event_group, attempt_failed);
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        const int64_t next_hedge = failed ? INT64_MAX : issueDueAttempts(now, timeout);
+        xSemaphoreGive(mutex);
+
+        http2_io::wake();
+
+        const int64_t wait_until = min(deadline, next_hedge);
+        const EventBits_t bits =
+            xEventGroupWaitBits(event_group, streams_done | connection_failed | attempt_failed, pdFALSE, pdFALSE,
+                                ((wait_until - now) / 1000 + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+
+        if (bits & connection_failed) {
             ESP_LOGE(TAG, "request failed");
             return Status::failed;
         }
+
+        if (bits & streams_done) break;
     }
 
+    if (latency && latency->samples > 0)
+        ESP_LOGI(TAG, "response latency %.0f +- %.0f msec", latency->mean_ms, latency->deviation_ms);
+
     return Status::done;
 }
+
+EventGroupHandle_t Http2Connection::getEventGroup() const { return event_group; }
+
+int Http2Connection::getSocket() const { return socket; }
+
+void Http2Connection::getInterest(bool& read, bool& write) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    read = !failed && nghttp2_session_want_read(handle.http2_sess);
+    write = !failed && nghttp2_session_want_write(handle.http2_sess);
+
+    xSemaphoreGive(mutex);
+}
+
+void Http2Connection::process(bool readable, bool writable) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    int result = 0;
+
+    if (!failed && writable) result = nghttp2_session_send(handle.http2_sess);
+    if (!failed && result == 0 && readable) result = nghttp2_session_recv(handle.http2_sess);
+
+    if (failed) {
+        // nothing to do
+    } else if (result != 0) {
+        ESP_LOGE(TAG, "HTTP2 session failed: %s", nghttp2_strerror(result));
+        fail();
+    } else if (!nghttp2_session_want_read(handle.http2_sess) && !nghttp2_session_want_write(handle.http2_sess)) {
+        ESP_LOGW(TAG, "HTTP2 session closed by server");
+        fail();
+    }
+
+    if (handle.ping_acks != ping_acks) {
+        ping_acks = handle.ping_acks;
+        xEventGroupSetBits(event_group, ping_ack);
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+void Http2Connection::completeRequest(Http2Request* request, Http2Request::State state) {
+    // A complete request's owner stream has just been closed, everything else that is still open is reset
+    for (int attempt = 0; attempt < request->attempts; attempt++) {
+        if (!request->attempt_active[attempt]) continue;
+        if (attempt == request->owner && state == Http2Request::State::complete) continue;
+
+        sh2lib_cancel(&handle, request->stream_ids[attempt]);
+        request->attempt_active[attempt] = false;
+    }
+
+    request->state = state;
+    if (request->data) request->data[request->len] = '\0';
+
+    if (request->notify_event_group) xEventGroupSetBits(request->notify_event_group, request->notify_bits);
+
+    Http2Request** slot = find(begin(pending_requests), end(pending_requests), request);
+    if (slot == end(pending_requests)) return;
+
+    *slot = nullptr;
+    if (--pending_request_count == 0) xEventGroupSetBits(event_group, streams_done);
+}
+
+void Http2Connection::fail() {
+    failed = true;
+    xEventGroupSetBits(event_group, connection_failed);
+}
@@ -1,30 +1,121 @@
 #ifndef _HTTP2_CONNECTION_H_
 #define _HTTP2_CONNECTION_H_
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include <mbedtls/x509_crt.h>
+
 #include <cstddef>
 #include <cstdint>
 
 #include "http2_request.h"
 #include "sh2lib.h"
 
-struct Http2Header {
-    const char* name;
-    const char* value;
+// TLS state kept across connections (and deep sleep) in order to speed up the handshake
+struct Http2TlsCache {
+    static constexpr size_t MAX_SESSION_SIZE = 512;
+
+    size_t session_size;  // serialized session for resumption, 0 if there is none
+    uint8_t session[MAX_SESSION_SIZE];
+
+    int8_t pin_depth;  // chain depth of the pinned certificate, -1 if there is no pin
+    uint8_t pin[32];   // SHA-256 of the pinned certificate's SubjectPublicKeyInfo
+
+    void clear() {
+        session_size = 0;
+        pin_depth = -1;
+    }
 };
 
+// Response latency of the streams on a connection (submission to response headers), smoothed like the TCP round trip
+// time (RFC 6298). Kept by the caller, e.g. across deep sleep.
+struct Http2LatencyEstimate {
+    float mean_ms;
+    float deviation_ms;
+    uint32_t samples;
+
+    void clear() {
+        mean_ms = deviation_ms = 0;
+        samples = 0;
+    }
+
+    void update(float latency_ms) {
+        if (samples == 0) {
+            mean_ms = latency_ms;
+            deviation_ms = latency_ms / 2;
+        } else {
+            deviation_ms += ((latency_ms > mean_ms ? latency_ms - mean_ms : mean_ms - latency_ms) - deviation_ms) / 4;
+            mean_ms += (latency_ms - mean_ms) / 8;
+        }
+
+        if (samples < UINT32_MAX) samples++;
+    }
+};
+
+// Streams are driven by the http2_io task once the connection is established. Callers submit requests and wait on
+// the connection's event group (or on the event of an individual request, see Http2Request::notifyOnCompletion).
+// All access to the HTTP/2 session is serialized by a mutex, so requests may be added or cancelled from any task.
 class Http2Connection {
    public:
     enum class Status { failed, done, timeout };
 
+    enum event_bit : EventBits_t {
+        streams_done = 0x01,
+        connection_failed = 0x02,
+        ping_ack = 0x04,
+        attempt_failed = 0x08
+    };
+
+    static constexpr size_t MAX_PENDING_REQUESTS = 8;
+
    public:
-    Http2Connection(const char* server_url);
+    // If a TLS cache is passed, its session is offered for resumption and replaced by the session of the new
+    // connection. With pin_depth >= 0 the certificate at this chain depth is pinned after the first full verification
+    // against the CA bundle. Later handshakes check the pin instead of searching the bundle, and fall back to bundle
+    // verification if the pin does not match anymore.
+    Http2Connection(const char* server_url, Http2TlsCache* tls_cache = nullptr, int8_t pin_depth = -1);
+    ~Http2Connection();
 
-    Status connect(uint32_t timeout);
+    // Connect to the given IPv4 address (network byte order) instead of resolving the server's host name. The host
+    // name is still used for SNI, certificate verification and the :authority header. The timeout bounds the whole
+    // connect, retries included.
+    Status connect(uint32_t timeout, uint32_t address = 0);
     void disconnect();
+    bool isConnected() const;
+
+    // Round trip a PING frame in order to check that a connection which has been idle is still alive. The connection
+    // is closed if there is no acknowledgement within the timeout.
+    Status ping(uint32_t timeout);
+
+    // IPv4 address of the connected server (network byte order), 0 if unknown
+    uint32_t getPeerAddress();
+
+    // Issue a request up to max_attempts times (at most Http2Request::MAX_ATTEMPTS) within the timeout of
+    // executePendingRequests(). A request is reissued right away if the server answers with 5xx or resets the stream.
+    // Requests added with hedge set are also issued again while the first attempt is still running once it is slower
+    // than the latency estimate suggests (mean + 4 * deviation, at least min_hedge_delay). Whichever attempt answers
+    // first becomes the owner, so only hedge requests the server does not mind seeing twice. The estimate is updated
+    // with every response.
+    void enableRetries(uint8_t max_attempts, Http2LatencyEstimate* latency, uint32_t min_hedge_delay);
+
+    void addRequest(const char* url, Http2Request* request, const Http2Header* headers, size_t header_count,
+                    bool hedge = false);
 
-    void addRequest(const char* url, Http2Request* request, const Http2Header* headers, size_t header_count);
+    // Reset the request's stream. The request is released immediately and may be destroyed afterwards.
+    void cancel(Http2Request* request);
+
+    // Wait until all streams have completed (or have been cancelled)
     Status executePendingRequests(uint32_t timeout);
 
+    // streams_done is set while no stream is pending, connection_failed once the session is unusable
+    EventGroupHandle_t getEventGroup() const;
+
+    // Interface of the http2_io task
+    int getSocket() const;
+    void getInterest(bool& read, bool& write);
+    void process(bool readable, bool writable);
+
    private:
     static int receive_cb(struct sh2lib_handle* handle, void* context, int stream_id, const char* data, size_t len,
                           int flags);
@@ -32,13 +123,53 @@ class Http2Connection {
     static int header_cb(struct sh2lib_handle* handle, void* context, int stream_id, const char* name, size_t name_len,
                          const char* value, size_t value_len);
 
+    static esp_err_t crt_bundle_attach(void* conf);
+    static int verify_cb(void* context, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+
+    int connectOnce(uint32_t timeout, const char* uri, const char* common_name);
+
+    static int attemptOf(const Http2Request* request, int stream_id);
+
+    int submitAttempt(Http2Request* request);
+    void dropAttempt(Http2Request* request, int attempt);
+    bool canRetry(const Http2Request* request) const;
+    int64_t issueDueAttempts(int64_t now, uint32_t timeout);
+
+    void completeRequest(Http2Request* request, Http2Request::State state);
+    void fail();
+
    private:
     const char* server_url;
 
+    Http2TlsCache* tls_cache;
+    int8_t pin_depth;
+
+    int (*bundle_verify)(void*, mbedtls_x509_crt*, int, uint32_t*){nullptr};
+    void* bundle_verify_context{nullptr};
+
+    int chain_top_depth{-1};
+    bool pin_used{false};
+    bool pin_confirmed{false};
+    bool pin_candidate_set{false};
+    uint8_t pin_candidate[32];
+
     bool connected{false};
+    bool failed{false};
     sh2lib_handle handle;
+    int socket{-1};
+    uint32_t session{0};  // incremented on every connect
+
+    SemaphoreHandle_t mutex{nullptr};
+    EventGroupHandle_t event_group{nullptr};
+
+    uint32_t pending_request_count{0};
+    uint32_t ping_acks{0};
+
+    Http2Request* pending_requests[MAX_PENDING_REQUESTS]{};
 
-    uint32_t pending_streams{0};
+    uint8_t max_attempts{1};
+    Http2LatencyEstimate* latency{nullptr};
+    uint32_t min_hedge_delay{0};
 
    private:
     Http2Connection(const Http2Connection&) = delete;
@@ -0,0 +1,182 @@
+#include "http2_io.h"
+
+#include <esp_log.h>
+#include <esp_vfs_eventfd.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+
+// clang-format off
+#include "freertos/FreeRTOS.h"
+// clang-format on
+
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "http2_connection.h"
+
+namespace {
+
+const char* TAG = "http2_io";
+
+constexpr size_t MAX_CONNECTIONS = 4;
+
+enum event_bit { fd_sets_rebuilt = 0x01 };
+
+TaskHandle_t task_handle{nullptr};
+SemaphoreHandle_t mutex;  // guards the connection list
+EventGroupHandle_t event_group_handle;
+
+Http2Connection* connections[MAX_CONNECTIONS];
+
+// eventfd, written by wake()
+int wake_fd{-1};
+
+void task_main(void*) {
+    fd_set read_fds, write_fds;
+
+    for (;;) {
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+
+        FD_SET(wake_fd, &read_fds);
+        int max_fd = wake_fd;
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        for (Http2Connection* connection : connections) {
+            if (!connection) continue;
+
+            bool read, write;
+            connection->getInterest(read, write);
+
+            const int fd = connection->getSocket();
+
+            if (read) FD_SET(fd, &read_fds);
+            if (write) FD_SET(fd, &write_fds);
+            if ((read || write) && fd > max_fd) max_fd = fd;
+        }
+
+        xEventGroupSetBits(event_group_handle, event_bit::fd_sets_rebuilt);
+        xSemaphoreGive(mutex);
+
+        if (select(max_fd + 1, &read_fds, &write_fds, nullptr, nullptr) < 0) {
+            ESP_LOGE(TAG, "select failed with errno %i", errno);
+
+            vTaskDelay(1);
+            continue;
+        }
+
+        if (FD_ISSET(wake_fd, &read_fds)) {
+            uint64_t value;
+            read(wake_fd, &value, sizeof(value));
+        }
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        for (Http2Connection* connection : connections) {
+            if (!connection) continue;
+
+            const int fd = connection->getSocket();
+            const bool readable = FD_ISSET(fd, &read_fds), writable = FD_ISSET(fd, &write_fds);
+
+            if (readable || writable) connection->process(readable, writable);
+        }
+
+        xSemaphoreGive(mutex);
+    }
+}
+
+bool start() {
+    esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    const esp_err_t result = esp_vfs_eventfd_register(&config);
+
+    if (result != ESP_OK && result != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "failed to register eventfd");
+        return false;
+    }
+
+    wake_fd = eventfd(0, 0);
+    if (wake_fd < 0) {
+        ESP_LOGE(TAG, "failed to create eventfd");
+        return false;
+    }
+
+    mutex = xSemaphoreCreateMutex();
+    event_group_handle = xEventGroupCreate();
+
+    xTaskCreate(task_main, "http2_io", 6144, nullptr, 5, &task_handle);
+
+    return true;
+}
+
+}  // namespace
+
+bool http2_io::attach(Http2Connection* connection) {
+    // Connections may be attached from several tasks, only the first one starts the I/O task
+    static const SemaphoreHandle_t start_mutex = xSemaphoreCreateMutex();
+
+    xSemaphoreTake(start_mutex, portMAX_DELAY);
+    const bool started = task_handle || start();
+    xSemaphoreGive(start_mutex);
+
+    if (!started) return false;
+
+    bool attached = false;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    for (Http2Connection*& slot : connections) {
+        if (slot) continue;
+
+        slot = connection;
+        attached = true;
+
+        break;
+    }
+
+    xSemaphoreGive(mutex);
+
+    if (!attached) {
+        ESP_LOGE(TAG, "too many connections");
+        return false;
+    }
+
+    wake();
+
+    return true;
+}
+
+void http2_io::detach(Http2Connection* connection) {
+    if (!task_handle) return;
+
+    bool detached = false;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    for (Http2Connection*& slot : connections) {
+        if (slot != connection) continue;
+
+        slot = nullptr;
+        detached = true;
+    }
+
+    if (detached) xEventGroupClearBits(event_group_handle, event_bit::fd_sets_rebuilt);
+
+    xSemaphoreGive(mutex);
+
+    if (!detached) return;
+
+    // The socket may still be part of a running select(), it must not be closed until the sets have been rebuilt
+    wake();
+    xEventGroupWaitBits(event_group_handle, event_bit::fd_sets_rebuilt, pdFALSE, pdFALSE, portMAX_DELAY);
+}
+
+void http2_io::wake() {
+    if (wake_fd < 0) return;
+
+    const uint64_t value = 1;
+    write(wake_fd, &value, sizeof(value));
+}
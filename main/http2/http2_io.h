@@ -0,0 +1,21 @@
+#ifndef _HTTP2_IO_H_
+#define _HTTP2_IO_H_
+
+class Http2Connection;
+
+// Single task that drives all established HTTP/2 connections. It waits in select() for socket readiness of every
+// attached connection and sends / receives frames as soon as the socket allows it.
+namespace http2_io {
+
+// Start serving the connection (the task is started on first use). Fails if too many connections are attached.
+bool attach(Http2Connection* connection);
+
+// Returns once the task does not access the connection or its socket anymore
+void detach(Http2Connection* connection);
+
+// Interrupt select() in order to pick up frames that have been queued by another task
+void wake();
+
+}  // namespace http2_io
+
+#endif  // _HTTP2_IO_H_
@@ -1,5 +1,7 @@
 #include "http2_request.h"
 
+#include "http2_connection.h"
+
 using namespace std;
 
 Http2Request::Http2Request(size_t max_data_len) : max_len(max_data_len) {
@@ -7,6 +9,20 @@ Http2Request::Http2Request(size_t max_data_len) : max_len(max_data_len) {
     data = make_unique<uint8_t[]>(max_data_len);
 }
 
+Http2Request::Http2Request(Http2DataCallback data_cb, void* data_cb_context)
+    : max_len(0), data_cb(data_cb), data_cb_context(data_cb_context) {
+    date[0] = '\0';
+}
+
+Http2Request::~Http2Request() {
+    if (connection && state == State::pending) connection->cancel(this);
+}
+
+void Http2Request::notifyOnCompletion(EventGroupHandle_t event_group, EventBits_t bits) {
+    notify_event_group = event_group;
+    notify_bits = bits;
+}
+
 Http2Request::State Http2Request::getState() const { return state; }
 
 const uint8_t* Http2Request::getData() const { return data.get(); }
@@ -1,6 +1,9 @@
 #ifndef _HTTP2_REQUEST_H_
 #define _HTTP2_REQUEST_H_
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -9,20 +12,39 @@
 
 class Http2Connection;
 
+struct Http2Header {
+    const char* name;
+    const char* value;
+};
+
+// Receives the response body chunk by chunk
+typedef void (*Http2DataCallback)(void* context, const char* data, size_t len);
+
 class Http2Request {
     friend Http2Connection;
 
    public:
-    enum class State { pending, complete };
+    enum class State { pending, complete, cancelled };
     static constexpr size_t MAX_DATE_LEN = 64;
+    static constexpr size_t MAX_PATH_LEN = 128;
+    static constexpr uint8_t MAX_ATTEMPTS = 4;
 
    public:
     Http2Request(size_t max_data_len);
 
+    // Pass the body to the callback as it arrives instead of buffering it (getData() returns nullptr)
+    Http2Request(Http2DataCallback data_cb, void* data_cb_context);
+
+    // A request that is still pending is cancelled
+    ~Http2Request();
+
+    // Set the given bits once the stream has been closed. Has to be called before the request is added.
+    void notifyOnCompletion(EventGroupHandle_t event_group, EventBits_t bits);
+
     State getState() const;
 
     const uint8_t* getData() const;
-    size_t getDataLen() const;
+    size_t getDataLen() const;  // body size received so far if streaming
 
     int32_t getHttpStatus() const;
     const char* getDate() const;
@@ -31,6 +53,25 @@ class Http2Request {
     struct sh2lib_callback_context_t callback_context;
 
     State state{State::pending};
+    uint32_t session{0};
+
+    // Kept for reissuing the request, the headers have to stay valid until the request has completed
+    char path[MAX_PATH_LEN];
+    const Http2Header* headers{nullptr};
+    size_t header_count{0};
+
+    // Every attempt is a stream of its own. The first attempt that responds without a retryable error becomes the
+    // owner, only its response is used.
+    int32_t stream_ids[MAX_ATTEMPTS];
+    int64_t attempt_timestamps[MAX_ATTEMPTS];
+    bool attempt_active[MAX_ATTEMPTS];
+    uint8_t attempts{0};
+    int8_t owner{-1};
+    bool hedge{false};  // reissued while still running if slow, not only once failed
+    int32_t rejected_status{-1};
+
+    EventGroupHandle_t notify_event_group{nullptr};
+    EventBits_t notify_bits{0};
 
     int32_t http_status{-1};
     char date[MAX_DATE_LEN];
@@ -39,6 +80,9 @@ class Http2Request {
     const size_t max_len;
     size_t len{0};
 
+    Http2DataCallback data_cb{nullptr};
+    void* data_cb_context{nullptr};
+
     Http2Connection* connection{nullptr};
 
    private:
@@ -8,7 +8,9 @@
 
 #include <ctype.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <http_parser.h>
+#include <mbedtls/ssl.h>
 #include <netdb.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -140,13 +142,17 @@ static int callback_on_frame_send(nghttp2_session *session, const nghttp2_frame
 
 static int callback_on_frame_recv(nghttp2_session *session, const nghttp2_frame *frame, void *user_data) {
     ESP_LOGD(TAG, "[frame-recv][sid: %d] frame type  %s", frame->hd.stream_id, sh2lib_frame_type_str(frame->hd.type));
+    if (frame->hd.type == NGHTTP2_PING && (frame->hd.flags & NGHTTP2_FLAG_ACK)) {
+        ((struct sh2lib_handle *)user_data)->ping_acks++;
+        return 0;
+    }
     if (frame->hd.type != NGHTTP2_DATA) {
         return 0;
     }
     /* Subsequent processing only for data frame */
     struct sh2lib_callback_context_t *callback_context =
         nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
-    if (callback_context->frame_data_recv_cb) {
+    if (callback_context && callback_context->frame_data_recv_cb) {
         struct sh2lib_handle *h2 = user_data;
         (*callback_context->frame_data_recv_cb)(h2, callback_context->context, 0, NULL, 0, DATA_RECV_FRAME_COMPLETE);
     }
@@ -156,7 +162,7 @@ static int callback_on_frame_recv(nghttp2_session *session, const nghttp2_frame
 static int callback_on_stream_close(nghttp2_session *session, int32_t stream_id, uint32_t error_code, void *user_data) {
     ESP_LOGD(TAG, "[stream-close][sid %d]", stream_id);
     struct sh2lib_callback_context_t *callback_context = nghttp2_session_get_stream_user_data(session, stream_id);
-    if (callback_context->frame_data_recv_cb) {
+    if (callback_context && callback_context->frame_data_recv_cb) {
         struct sh2lib_handle *h2 = user_data;
         (*callback_context->frame_data_recv_cb)(h2, callback_context->context, stream_id, NULL, 0,
                                                 DATA_RECV_RST_STREAM);
@@ -168,7 +174,7 @@ static int callback_on_data_chunk_recv(nghttp2_session *session, uint8_t flags,
                                        size_t len, void *user_data) {
     ESP_LOGD(TAG, "[data-chunk][sid:%d]", stream_id);
     struct sh2lib_callback_context_t *callback_context = nghttp2_session_get_stream_user_data(session, stream_id);
-    if (callback_context->frame_data_recv_cb) {
+    if (callback_context && callback_context->frame_data_recv_cb) {
         ESP_LOGD(TAG,
                  "[data-chunk] C <---------------------------- S (DATA chunk)"
                  "%lu bytes",
@@ -185,7 +191,7 @@ static int callback_on_header(nghttp2_session *session, const nghttp2_frame *fra
     struct sh2lib_callback_context_t *callback_context =
         nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
 
-    if (callback_context->header_cb) {
+    if (callback_context && callback_context->header_cb) {
         (*callback_context->header_cb)((struct sh2lib_handle *)user_data, callback_context->context,
                                        frame->hd.stream_id, (const char *)name, namelen, (const char *)value, valuelen);
     }
@@ -221,14 +227,52 @@ static int do_http2_connect(struct sh2lib_handle *hd) {
     return 0;
 }
 
-int sh2lib_connect(struct sh2lib_config_t *cfg, struct sh2lib_handle *hd, uint32_t timeout) {
-    memset(hd, 0, sizeof(*hd));
+/*
+ * esp-tls keeps the definition of esp_tls_client_session_t private. With mbedtls it only wraps
+ * the mbedtls session, so a session allocated here can be handed to esp-tls and is released by
+ * esp_tls_free_client_session(). This was checked against esp-tls of IDF 5.0 (see dependencies.lock),
+ * check the definition in esp-tls/private_include/esp_tls_private.h before allowing other versions.
+ */
+#if !CONFIG_ESP_TLS_USING_MBEDTLS || !CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS || \
+    ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0) || ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#error "load_client_session() relies on the layout of esp_tls_client_session_t, which is unchecked for this IDF"
+#endif
 
-    if (cfg == NULL) {
-        ESP_LOGE(TAG, "[sh2-connect] pointer to sh2lib configurations cannot be NULL");
-        goto error;
+static esp_tls_client_session_t *load_client_session(const unsigned char *buf, size_t bytes) {
+    if (buf == NULL || bytes == 0) return NULL;
+
+    mbedtls_ssl_session *session = calloc(1, sizeof(mbedtls_ssl_session));
+    if (session == NULL) return NULL;
+
+    mbedtls_ssl_session_init(session);
+
+    if (mbedtls_ssl_session_load(session, buf, bytes) != 0) {
+        ESP_LOGW(TAG, "[sh2-connect] stored TLS session is invalid, ignoring it");
+
+        mbedtls_ssl_session_free(session);
+        free(session);
+
+        return NULL;
     }
 
+    return (esp_tls_client_session_t *)session;
+}
+
+/* Why tls_connect() failed */
+#define TLS_FAILED_CONNECT -1     /* server not reachable or timeout */
+#define TLS_FAILED_HANDSHAKE -2   /* the handshake failed */
+#define TLS_FAILED_CERTIFICATE -3 /* the server certificate was not accepted */
+
+static int tls_failure(esp_tls_t *tls) {
+    esp_tls_error_handle_t error_handle;
+    if (esp_tls_get_error_handle(tls, &error_handle) != ESP_OK || error_handle == NULL) return TLS_FAILED_CONNECT;
+
+    if (error_handle->last_error != ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED) return TLS_FAILED_CONNECT;
+    return error_handle->esp_tls_flags != 0 ? TLS_FAILED_CERTIFICATE : TLS_FAILED_HANDSHAKE;
+}
+
+static int tls_connect(struct sh2lib_config_t *cfg, struct sh2lib_handle *hd, uint32_t timeout,
+                       esp_tls_client_session_t *client_session) {
     const char *proto[] = {"h2", NULL};
     esp_tls_cfg_t tls_cfg = {
         .alpn_protos = proto,
@@ -237,13 +281,15 @@ int sh2lib_connect(struct sh2lib_config_t *cfg, struct sh2lib_handle *hd, uint32
         .crt_bundle_attach = cfg->crt_bundle_attach,
         .non_block = true,
         .timeout_ms = timeout,
+        .common_name = cfg->common_name,
+        .client_session = client_session,
     };
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
     hd->http2_tls = esp_tls_init();
     if (!hd->http2_tls) {
         ESP_LOGE(TAG, "Failed to allocate esp_tls handle!");
-        goto error;
+        return -1;
     }
 
     // NOTE: This API is an alternative to previous `esp_tls_conn_http_new` from ESP-IDF v5.0 onwards.
@@ -251,14 +297,63 @@ int sh2lib_connect(struct sh2lib_config_t *cfg, struct sh2lib_handle *hd, uint32
 #else
     if ((hd->http2_tls = esp_tls_conn_http_new(cfg->uri, &tls_cfg)) == NULL) {
 #endif
+        int failure = TLS_FAILED_CONNECT;
+
+        if (hd->http2_tls) {
+            failure = tls_failure(hd->http2_tls);
+
+            esp_tls_conn_destroy(hd->http2_tls);
+            hd->http2_tls = NULL;
+        }
+
+        return failure;
+    }
+
+    return 0;
+}
+
+int sh2lib_connect(struct sh2lib_config_t *cfg, struct sh2lib_handle *hd, uint32_t timeout) {
+    memset(hd, 0, sizeof(*hd));
+
+    if (cfg == NULL) {
+        ESP_LOGE(TAG, "[sh2-connect] pointer to sh2lib configurations cannot be NULL");
+        goto error;
+    }
+
+    const int64_t end = esp_timer_get_time() + 1000ll * timeout;
+
+    esp_tls_client_session_t *client_session = load_client_session(cfg->session_buf, cfg->session_bytes);
+    int tls_result = tls_connect(cfg, hd, timeout, client_session);
+
+    if (client_session) {
+        esp_tls_free_client_session(client_session);
+
+        if (tls_result == TLS_FAILED_HANDSHAKE) {
+            hd->session_rejected = true;
+
+            /* the full handshake gets what is left of the timeout */
+            const int64_t left = (end - esp_timer_get_time()) / 1000;
+
+            if (left > 0) {
+                ESP_LOGW(TAG, "[sh2-connect] handshake with stored TLS session failed, retrying with full handshake");
+                tls_result = tls_connect(cfg, hd, (uint32_t)left, NULL);
+            }
+        }
+    }
+
+    if (tls_result != 0) {
         ESP_LOGE(TAG, "[sh2-connect] esp-tls connection failed");
         goto error;
     }
 
-    struct http_parser_url u;
-    http_parser_url_init(&u);
-    http_parser_parse_url(cfg->uri, strlen(cfg->uri), 0, &u);
-    hd->hostname = strndup(&cfg->uri[u.field_data[UF_HOST].off], u.field_data[UF_HOST].len);
+    if (cfg->common_name) {
+        hd->hostname = strdup(cfg->common_name);
+    } else {
+        struct http_parser_url u;
+        http_parser_url_init(&u);
+        http_parser_parse_url(cfg->uri, strlen(cfg->uri), 0, &u);
+        hd->hostname = strndup(&cfg->uri[u.field_data[UF_HOST].off], u.field_data[UF_HOST].len);
+    }
 
     /* HTTP/2 Connection */
     if (do_http2_connect(hd) != 0) {
@@ -369,6 +464,26 @@ esp_err_t sh2lib_get_sockfd(struct sh2lib_handle *hd, int *sockfd) {
     return esp_tls_get_conn_sockfd(hd->http2_tls, sockfd);
 }
 
+int sh2lib_save_session(struct sh2lib_handle *hd, unsigned char *buf, size_t size, size_t *olen) {
+    mbedtls_ssl_context *ssl = esp_tls_get_ssl_context(hd->http2_tls);
+    if (ssl == NULL) return -1;
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    int ret = mbedtls_ssl_get_session(ssl, &session);
+    if (ret == 0) ret = mbedtls_ssl_session_save(&session, buf, size, olen);
+
+    mbedtls_ssl_session_free(&session);
+
+    if (ret != 0) {
+        ESP_LOGE(TAG, "failed to save TLS session: -0x%04x", -ret);
+        return -1;
+    }
+
+    return 0;
+}
+
 int sh2lib_execute_sync(struct sh2lib_handle *hd, int32_t timeout) {
     int sockfd;
     fd_set fds, fds_error;
@@ -415,3 +530,23 @@ int sh2lib_execute_sync(struct sh2lib_handle *hd, int32_t timeout) {
 
     return 0;
 }
+
+int sh2lib_ping(struct sh2lib_handle *hd) {
+    if (nghttp2_submit_ping(hd->http2_sess, NGHTTP2_FLAG_NONE, NULL) != 0) {
+        ESP_LOGE(TAG, "[sh2-ping] failed to submit PING");
+        return -1;
+    }
+
+    return 0;
+}
+
+int sh2lib_cancel(struct sh2lib_handle *hd, int32_t stream_id) {
+    nghttp2_session_set_stream_user_data(hd->http2_sess, stream_id, NULL);
+
+    if (nghttp2_submit_rst_stream(hd->http2_sess, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL) != 0) {
+        ESP_LOGE(TAG, "[sh2-cancel] failed to reset stream %d", stream_id);
+        return -1;
+    }
+
+    return 0;
+}
@@ -34,6 +34,8 @@ struct sh2lib_handle {
     nghttp2_session *http2_sess; /*!< Pointer to the HTTP2 session handle */
     char *hostname;              /*!< The hostname we are connected to */
     struct esp_tls *http2_tls;   /*!< Pointer to the TLS session handle */
+    uint32_t ping_acks;          /*!< Number of PING acknowledgements received from the server */
+    bool session_rejected;       /*!< The handshake resuming the stored TLS session failed (see sh2lib_connect) */
 };
 
 /**
@@ -46,6 +48,10 @@ struct sh2lib_config_t {
     esp_err_t (*crt_bundle_attach)(void *conf);
     /*!< Function pointer to esp_crt_bundle_attach. Enables the use of certification
          bundle for server verification, must be enabled in menuconfig */
+    const char *common_name;          /*!< Server name for SNI, certificate verification and the :authority header.
+                                           Optional, defaults to the host of the URI (which may be an address) */
+    const unsigned char *session_buf; /*!< Serialized TLS session to resume (see sh2lib_save_session), optional */
+    size_t session_bytes;             /*!< Size of the serialized session pointed by session_buf */
 };
 
 /** Flag indicating receive stream is reset */
@@ -111,6 +117,11 @@ struct sh2lib_callback_context_t {
  *
  * Only 'https' URIs are supported.
  *
+ * If a stored TLS session is given and the handshake resuming it fails, session_rejected
+ * is set in the handle and a full handshake is attempted. No full handshake is attempted
+ * if the server could not be reached or its certificate was not accepted, the stored
+ * session is not at fault then. The timeout (msec) bounds both handshakes together.
+ *
  * @param[in]  cfg     Pointer to the sh2lib configurations of the type 'struct sh2lib_config_t'.
  * @param[out] hd      Pointer to a variable of the type 'struct sh2lib_handle'.
  * @return
@@ -163,8 +174,55 @@ int sh2lib_do_putpost_with_nv(struct sh2lib_handle *hd, const nghttp2_nv *nva, s
 
 esp_err_t sh2lib_get_sockfd(struct sh2lib_handle *hd, int *sockfd);
 
+/**
+ * @brief Serialize the TLS session of an established connection
+ *
+ * The result can be passed as session_buf to a later sh2lib_connect() in order to
+ * resume the session instead of performing a full handshake.
+ *
+ * @param[in]  hd     Pointer to a variable of the type 'struct sh2lib_handle'
+ * @param[out] buf    Buffer receiving the serialized session
+ * @param[in]  size   Size of buf
+ * @param[out] olen   Size of the serialized session
+ *
+ * @return
+ *             - 0 on success
+ *             - -1 if the session could not be retrieved or does not fit into buf
+ */
+int sh2lib_save_session(struct sh2lib_handle *hd, unsigned char *buf, size_t size, size_t *olen);
+
 int sh2lib_execute_sync(struct sh2lib_handle *hd, int32_t timeout);
 
+/**
+ * @brief Queue a PING frame
+ *
+ * The frame is sent by the next sh2lib_execute(_sync). The acknowledgement increments
+ * ping_acks of the handle.
+ *
+ * @param[in] hd      Pointer to a variable of the type 'struct sh2lib_handle'
+ *
+ * @return
+ *             - 0 on success
+ *             - -1 if the frame could not be queued
+ */
+int sh2lib_ping(struct sh2lib_handle *hd);
+
+/**
+ * @brief Cancel a stream
+ *
+ * Queues RST_STREAM (CANCEL) for the stream, or drops its HEADERS if they have not been
+ * sent yet. No more callbacks are invoked for the stream, so its callback context may be
+ * released right away.
+ *
+ * @param[in] hd         Pointer to a variable of the type 'struct sh2lib_handle'
+ * @param[in] stream_id  Stream ID as returned by sh2lib_do_get(_with_nv) etc.
+ *
+ * @return
+ *             - 0 on success
+ *             - -1 if the stream could not be reset
+ */
+int sh2lib_cancel(struct sh2lib_handle *hd, int32_t stream_id);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,270 @@
+#include "json_scanner.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+bool is_token_char(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+}  // namespace
+
+JsonScanner::JsonScanner(const field_t* fields, size_t field_count)
+    : fields(fields), field_count(field_count > MAX_FIELDS ? MAX_FIELDS : field_count) {
+    reset();
+}
+
+void JsonScanner::setStringFields(const string_field_t* fields, size_t field_count) {
+    string_fields = fields;
+    string_field_count = field_count;
+}
+
+void JsonScanner::setElementCallback(const char* path, ElementCallback callback, void* context) {
+    element_path = path;
+    element_callback = callback;
+    element_context = context;
+}
+
+void JsonScanner::reset() {
+    state = State::value;
+    found = 0;
+    depth = 0;
+    path_len = token_len = 0;
+    path[0] = '\0';
+    string_value = nullptr;
+}
+
+bool JsonScanner::feed(const char* data, size_t len) {
+    for (size_t i = 0; i < len && state != State::error; i++) {
+        // a token is only terminated by the character following it, which is processed again afterwards
+        if (!consume(data[i])) consume(data[i]);
+    }
+
+    return state != State::error;
+}
+
+bool JsonScanner::isComplete() const { return state == State::done; }
+
+bool JsonScanner::isFound(size_t field) const { return found & (1u << field); }
+
+bool JsonScanner::allFound() const { return found == (field_count == 32 ? 0xffffffff : (1u << field_count) - 1); }
+
+// Returns false if the character has not been consumed
+bool JsonScanner::consume(char c) {
+    switch (state) {
+        case State::value:
+            if (is_whitespace(c)) break;
+
+            if (c == '{') {
+                state = push(false) ? State::first_key : State::error;
+            } else if (c == '[') {
+                state = push(true) ? State::first_value : State::error;
+            } else if (c == '"') {
+                beginString();
+                state = State::string;
+            } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                token[0] = c;
+                token_len = 1;
+                state = State::token;
+            } else {
+                state = State::error;
+            }
+
+            break;
+
+        case State::first_value:
+            if (is_whitespace(c)) break;
+
+            if (c == ']') {
+                pop();
+                break;
+            }
+
+            state = State::value;
+            return false;
+
+        case State::first_key:
+        case State::key:
+            if (is_whitespace(c)) break;
+
+            if (c == '"') {
+                truncatePath(stack[depth - 1].path_len);
+                if (path_len > 0) appendPath('.');
+
+                state = State::key_string;
+            } else if (c == '}' && state == State::first_key) {
+                pop();
+            } else {
+                state = State::error;
+            }
+
+            break;
+
+        case State::key_string:
+            if (c == '\\')
+                state = State::key_escape;
+            else if (c == '"')
+                state = State::colon;
+            else
+                appendPath(c);
+
+            break;
+
+        case State::key_escape:
+            appendPath(c);
+            state = State::key_string;
+
+            break;
+
+        case State::colon:
+            if (is_whitespace(c)) break;
+
+            state = c == ':' ? State::value : State::error;
+            break;
+
+        case State::string:
+            if (c == '\\')
+                state = State::string_escape;
+            else if (c == '"')
+                endValue();
+            else
+                appendString(c);
+
+            break;
+
+        case State::string_escape:
+            appendString(c);
+            state = State::string;
+            break;
+
+        case State::token:
+            if (is_token_char(c)) {
+                if (token_len == MAX_TOKEN_LEN) {
+                    state = State::error;
+                    break;
+                }
+
+                token[token_len++] = c;
+                break;
+            }
+
+            endToken();
+            return state == State::error;
+
+        case State::next:
+            if (is_whitespace(c)) break;
+
+            if (c == ',')
+                state = stack[depth - 1].array ? State::value : State::key;
+            else if (c == (stack[depth - 1].array ? ']' : '}'))
+                pop();
+            else
+                state = State::error;
+
+            break;
+
+        case State::done:
+            if (!is_whitespace(c)) state = State::error;
+            break;
+
+        case State::error:
+            break;
+    }
+
+    return true;
+}
+
+bool JsonScanner::push(bool array) {
+    if (depth == MAX_DEPTH) return false;
+
+    stack[depth++] = {.array = array, .path_len = path_len};
+
+    if (array) {
+        appendPath('[');
+        appendPath(']');
+    }
+
+    return true;
+}
+
+void JsonScanner::pop() {
+    truncatePath(stack[--depth].path_len);
+    endValue();
+}
+
+void JsonScanner::endValue() {
+    state = depth == 0 ? State::done : State::next;
+
+    if (element_callback && path_len < MAX_PATH_LEN && strcmp(path, element_path) == 0)
+        element_callback(element_context);
+}
+
+void JsonScanner::endToken() {
+    token[token_len] = '\0';
+
+    if (strcmp(token, "true") == 0 || strcmp(token, "false") == 0 || strcmp(token, "null") == 0) {
+        endValue();
+        return;
+    }
+
+    char* end;
+    const float value = strtof(token, &end);
+
+    if (token[0] == 't' || token[0] == 'f' || token[0] == 'n' || *end != '\0') {
+        state = State::error;
+        return;
+    }
+
+    if (path_len < MAX_PATH_LEN) {
+        for (size_t i = 0; i < field_count; i++) {
+            if (strcmp(fields[i].path, path) != 0) continue;
+
+            *fields[i].value = value;
+            found |= 1u << i;
+        }
+    }
+
+    endValue();
+}
+
+void JsonScanner::beginString() {
+    string_value = nullptr;
+    if (path_len == MAX_PATH_LEN) return;
+
+    for (size_t i = 0; i < string_field_count; i++) {
+        if (strcmp(string_fields[i].path, path) != 0) continue;
+
+        string_value = string_fields[i].value;
+        string_size = string_fields[i].size;
+        string_len = 0;
+        string_value[0] = '\0';
+
+        return;
+    }
+}
+
+void JsonScanner::appendString(char c) {
+    if (!string_value || string_len + 1 >= string_size) return;
+
+    string_value[string_len++] = c;
+    string_value[string_len] = '\0';
+}
+
+void JsonScanner::appendPath(char c) {
+    if (path_len >= MAX_PATH_LEN - 1) {
+        path_len = MAX_PATH_LEN;
+        return;
+    }
+
+    path[path_len++] = c;
+    path[path_len] = '\0';
+}
+
+void JsonScanner::truncatePath(uint8_t len) {
+    path_len = len;
+    if (len < MAX_PATH_LEN) path[len] = '\0';
+}
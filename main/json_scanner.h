@@ -0,0 +1,117 @@
+#ifndef _JSON_SCANNER_H_
+#define _JSON_SCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// Incremental JSON scanner that extracts selected numeric fields while a document is being received. The document
+/// is fed in chunks of arbitrary size and is never stored; memory use is fixed and nothing is allocated.
+///
+/// Fields are selected by their path, e.g. "code" or "data.ppv" (object keys joined by '.', array elements
+/// are addressed as "list[]"). Only numbers are extracted, a field holding another type counts as missing. Strings
+/// can be extracted by string fields, and arrays of records are read one element at a time with an element callback.
+class JsonScanner {
+   public:
+    struct field_t {
+        const char* path;
+        float* value;
+    };
+
+    struct string_field_t {
+        const char* path;
+        char* value;
+        size_t size;  // including the terminating '\0', longer strings are truncated
+    };
+
+    typedef void (*ElementCallback)(void* context);
+
+    static constexpr size_t MAX_FIELDS = 32;
+    static constexpr size_t MAX_DEPTH = 8;
+    static constexpr size_t MAX_PATH_LEN = 48;
+    static constexpr size_t MAX_TOKEN_LEN = 32;
+
+   public:
+    JsonScanner(const field_t* fields, size_t field_count);
+
+    void setStringFields(const string_field_t* fields, size_t field_count);
+
+    // Invoked whenever a value at the path has been scanned, e.g. after every element of "list[]"
+    void setElementCallback(const char* path, ElementCallback callback, void* context);
+
+    void reset();
+
+    // Returns false once the document turned out to be malformed
+    bool feed(const char* data, size_t len);
+
+    // The top level value has been closed
+    bool isComplete() const;
+
+    bool isFound(size_t field) const;
+    bool allFound() const;
+
+   private:
+    enum class State : uint8_t {
+        value,
+        first_value,
+        first_key,
+        key,
+        key_string,
+        key_escape,
+        colon,
+        string,
+        string_escape,
+        token,
+        next,
+        done,
+        error
+    };
+
+    struct container_t {
+        bool array;
+        uint8_t path_len;  // length of the container's own path
+    };
+
+   private:
+    bool consume(char c);
+
+    bool push(bool array);
+    void pop();
+    void endValue();
+    void endToken();
+
+    void beginString();
+    void appendString(char c);
+
+    void appendPath(char c);
+    void truncatePath(uint8_t len);
+
+   private:
+    const field_t* fields;
+    size_t field_count;
+
+    const string_field_t* string_fields{nullptr};
+    size_t string_field_count{0};
+
+    const char* element_path{nullptr};
+    ElementCallback element_callback{nullptr};
+    void* element_context{nullptr};
+
+    State state{State::value};
+    uint32_t found{0};
+
+    container_t stack[MAX_DEPTH];
+    uint8_t depth{0};
+
+    char path[MAX_PATH_LEN + 1];
+    uint8_t path_len{0};  // MAX_PATH_LEN if the path has been truncated (and can not match)
+
+    char token[MAX_TOKEN_LEN + 1];
+    uint8_t token_len{0};
+
+    // Buffer of the string field being scanned, nullptr if the current string is not extracted
+    char* string_value{nullptr};
+    size_t string_size{0};
+    size_t string_len{0};
+};
+
+#endif  // _JSON_SCANNER_H_
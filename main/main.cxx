@@ -4,6 +4,8 @@
 #include <esp_sleep.h>
 #include <esp_system.h>
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <nvs_flash.h>
 #include <sys/time.h>
 
@@ -13,11 +15,17 @@
 #include <sstream>
 
 #include "api.h"
+#include "clock_discipline.h"
+#include "cloud_phase.h"
 #include "config.h"
 #include "date-rfc/rfc-1123.h"
+#include "defer.h"
 #include "display_task.h"
+#include "history.h"
 #include "network.h"
 #include "persistence.h"
+#include "scheduler.h"
+#include "timeseries.h"
 #include "view.h"
 
 using namespace std;
@@ -28,6 +36,8 @@ const char* TAG = "main";
 
 view::model_t current_view;
 
+bool network_connected{false};
+
 void init_nvfs() {
     esp_err_t result = nvs_flash_init();
     if (result == ESP_ERR_NVS_NO_FREE_PAGES || result == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -39,6 +49,9 @@ void init_nvfs() {
 }
 
 void set_date_from_header(const char* header) {
+    // There is none from the Modbus source
+    if (*header == '\0') return;
+
     time_t tm = 0;
     istringstream sstream(header);
 
@@ -48,34 +61,65 @@ void set_date_from_header(const char* header) {
         return;
     }
 
-    timeval tv = {.tv_sec = tm};
+    timeval tv;
+    gettimeofday(&tv, nullptr);
 
-    if (settimeofday(&tv, nullptr) == 0) {
-        persistence::ts_last_time_sync = static_cast<uint64_t>(time(nullptr));
-        ESP_LOGI(TAG, "updated time to %lli from server timestamp", tm);
-    } else {
-        ESP_LOGE(TAG, "failed to update time from server timestamp");
+    // The date is truncated to seconds
+    const int64_t offset_usec = tm * 1000000ll + 500000 - (tv.tv_sec * 1000000ll + tv.tv_usec);
+    clock_discipline::observe(offset_usec, clock_discipline::HTTP_DATE_SIGMA_USEC);
+}
+
+// Readings older than their TTL are not shown
+void expire_readings(view::model_t& view) {
+    const uint64_t now = static_cast<uint64_t>(time(nullptr));
+
+    view.ts_current_power = persistence::ts_last_update_current_power;
+
+    if (now - persistence::ts_last_update_current_power > TTL_CURRENT_POWER_MINUTES * 60) {
+        view.power_pv_w = -1;
+        view.load_w = -1;
+        view.charge = -1;
+    }
+
+    if (now - persistence::ts_last_update_accumulated_power > TTL_ACCUMULATED_POWER_MINUTES * 60) {
+        view.power_pv_accumulated_kwh = -1;
+        view.load_accumulated_kwh = -1;
+        view.power_network_accumulated_kwh = -1;
+        view.power_surplus_accumulated_kwh = -1;
     }
 }
 
-void update_view() {
+void update_view(Deadline& deadline) {
     current_view = persistence::last_view;
+    Defer defer_expire([]() { expire_readings(current_view); });
 
-    current_view.network_result = network::start();
-    if (current_view.network_result != network::result_t::ok) {
-        persistence::reset_ip_info();
-        return;
-    };
+    if (!network_connected) {
+        current_view.network_result = network::start(deadline);
+        if (current_view.network_result != network::result_t::ok) {
+            persistence::reset_ip_info();
+            return;
+        };
+
+        network_connected = true;
+    }
 
     const uint64_t now = static_cast<uint64_t>(time(nullptr));
     current_view.epoch = now;
 
-    current_view.connection_status = api::perform_request();
+    // The gap is closed by the readings of this update already, so it is kept in mind until a backfill succeeds
+    if (now - persistence::ts_last_update_current_power > BACKFILL_MIN_GAP_SEC) persistence::backfill_pending = true;
+
+    current_view.connection_status = api::perform_request(deadline, persistence::backfill_pending);
     if (current_view.connection_status != api::connection_status_t::ok) {
         persistence::reset_ip_info();
         return;
     }
 
+    if (api::get_backfill_request_status() == api::request_status_t::ok) {
+        history::merge(current_view.history, api::get_backfill_response());
+        persistence::backfill_pending = false;
+    }
+
     if (persistence::ts_first_update == 0) persistence::ts_first_update = now;
 
     current_view.request_status_current_power = api::get_current_power_request_status();
@@ -87,6 +131,18 @@ void update_view() {
         current_view.charge = round(response.soc);
 
         persistence::ts_last_update_current_power = now;
+        history::record(current_view.history, now, current_view.power_pv_w, current_view.load_w);
+        scheduler::record(persistence::activity, now, current_view.power_pv_w, current_view.load_w);
+        timeseries::append(persistence::readings, {.epoch = now,
+                                                   .pv_w = response.ppv,
+                                                   .load_w = response.pload,
+                                                   .soc = response.soc,
+                                                   .pgrid_w = response.pgrid,
+                                                   .pbat_w = response.pbat});
+#if !MODBUS_SOURCE
+        cloud_phase::observe(persistence::cloud_refresh, static_cast<uint64_t>(time(nullptr)),
+                             cloud_phase::digest(&response, sizeof(response)), response.ppv <= 0);
+#endif
 
         ESP_LOGI(TAG, "ppv = %f | pload = %f | soc = %f | pgrid = %f | pbat = %f", response.ppv, response.pload,
                  response.soc, response.pgrid, response.pbat);
@@ -120,20 +176,104 @@ void update_view() {
                  response.eCharge, response.eDischarge, response.eGridCharge, response.eInput, response.eOutput,
                  response.epv);
     }
+}
 
-    if (now - persistence::ts_last_update_current_power > TTL_CURRENT_POWER_MINUTES * 60) {
-        current_view.power_pv_w = -1;
-        current_view.load_w = -1;
-        current_view.charge = -1;
+scheduler::failure_t classify_failure() {
+    switch (current_view.network_result) {
+        case network::result_t::ok:
+            break;
+
+        case network::result_t::sntp_timeout:
+            return scheduler::failure_t::time_sync;
+
+        default:
+            return scheduler::failure_t::wifi;
     }
 
-    if (now - persistence::ts_last_update_accumulated_power > TTL_ACCUMULATED_POWER_MINUTES * 60) {
-        current_view.power_pv_accumulated_kwh = -1;
-        current_view.load_accumulated_kwh = -1;
-        current_view.power_network_accumulated_kwh = -1;
-        current_view.power_surplus_accumulated_kwh = -1;
+    if (current_view.connection_status != api::connection_status_t::ok) return scheduler::failure_t::connection;
+    if (current_view.request_status_current_power != api::request_status_t::ok) return scheduler::failure_t::api;
+
+    return scheduler::failure_t::none;
+}
+
+// Whether two views differ in nothing but their time (the history only changes with new data)
+bool shows_same(const view::model_t& a, const view::model_t& b) {
+    return a.battery_status == b.battery_status && a.charging == b.charging && a.network_result == b.network_result &&
+           a.connection_status == b.connection_status &&
+           a.request_status_current_power == b.request_status_current_power &&
+           a.request_status_accumulated_power == b.request_status_accumulated_power &&
+           a.power_pv_w == b.power_pv_w && a.power_pv_accumulated_kwh == b.power_pv_accumulated_kwh &&
+           a.load_w == b.load_w && a.load_accumulated_kwh == b.load_accumulated_kwh &&
+           a.power_surplus_accumulated_kwh == b.power_surplus_accumulated_kwh &&
+           a.power_network_accumulated_kwh == b.power_network_accumulated_kwh && a.charge == b.charge;
+}
+
+#if CONTINUOUS_MODE
+// Update every RATE_LIMIT_CURRENT_POWER_SEC seconds over the same Wi-Fi association and API connection. Returns
+// (with the last update still being displayed) only if the network could not be started; the caller then falls back
+// to deep sleep, which retries from scratch.
+void run_continuously() {
+    for (;;) {
+        const int64_t timestamp = esp_timer_get_time();
+        Deadline deadline(CYCLE_BUDGET_MSEC, persistence::phase_latencies);
+
+        clock_discipline::correct();
+        update_view(deadline);
+        scheduler::record(persistence::backoff, classify_failure());
+        display_task::display(current_view);
+
+        if (!network_connected) return;
+
+        display_task::wait();
+        persistence::last_view = current_view;
+
+        const int64_t elapsed_msec = (esp_timer_get_time() - timestamp) / 1000;
+        ESP_LOGI(TAG, "update cycle took %lli msec", elapsed_msec);
+
+        if (elapsed_msec < RATE_LIMIT_CURRENT_POWER_SEC * 1000)
+            vTaskDelay((RATE_LIMIT_CURRENT_POWER_SEC * 1000 - elapsed_msec) / portTICK_PERIOD_MS);
     }
 }
+#endif
+
+// Wakes may come a little early, as the RTC slow clock drifts
+bool network_update_due() {
+    return CLOCK_UPDATE_SECONDS == 0 || static_cast<uint64_t>(time(nullptr)) + 1 >= persistence::ts_next_network_update;
+}
+
+// Shows the last view with the current time, without touching the radio
+void update_clock() {
+    current_view = persistence::last_view;
+    current_view.epoch = static_cast<uint64_t>(time(nullptr));
+    expire_readings(current_view);
+
+    display_task::display(current_view);
+}
+
+// Until the next clock or network update, whichever comes first
+uint32_t sleep_seconds() {
+    const uint64_t now = static_cast<uint64_t>(time(nullptr));
+    uint64_t wake = persistence::ts_next_network_update;
+
+#if CLOCK_UPDATE_SECONDS
+    // Clock updates are aligned to the displayed minute
+    wake = min(wake, now - now % CLOCK_UPDATE_SECONDS + CLOCK_UPDATE_SECONDS);
+#endif
+
+    return max<int64_t>(static_cast<int64_t>(wake - now), 1);
+}
+
+void enter_deep_sleep() {
+    persistence::last_view = current_view;
+
+    const uint32_t seconds = sleep_seconds();
+    ESP_LOGI(TAG, "going to sleep for %lu sec", seconds);
+
+    for (auto domain : {ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_DOMAIN_RTC_FAST_MEM, ESP_PD_DOMAIN_VDDSDIO})
+        esp_sleep_pd_config(domain, ESP_PD_OPTION_AUTO);
+
+    esp_deep_sleep(seconds * 1000000ull);
+}
 
 }  // namespace
 
@@ -145,27 +285,60 @@ extern "C" void app_main(void) {
     tzset();
 
     persistence::init();
-    display_task::start();
+    clock_discipline::correct();
+
+    if (!network_update_due()) {
+        ESP_LOGI(TAG, "clock update");
+
+        display_task::start();
+        update_clock();
+        display_task::wait();
+
+        enter_deep_sleep();
+    }
+
+    // During a backoff the display is started only once the result is known, it may just repeat the error shown
+    bool display_started = CONTINUOUS_MODE || persistence::backoff.count == 0;
+    if (display_started) display_task::start();
+
     init_nvfs();
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     network::init();
     api::init();
 
-    update_view();
+#if CONTINUOUS_MODE
+    run_continuously();
+#else
+    Deadline deadline(CYCLE_BUDGET_MSEC, persistence::phase_latencies);
+    update_view(deadline);
 
-    display_task::display(current_view);
+    if (scheduler::record(persistence::backoff, classify_failure()) &&
+        shows_same(current_view, persistence::last_view)) {
+        ESP_LOGI(TAG, "same error as before, skipping display update");
 
-#if !UDP_LOGGING
-    network::stop();
-#endif
-    display_task::wait();
+        // The last view has to match the display for the next partial update
+        current_view = persistence::last_view;
+    } else {
+        if (!display_started) display_task::start();
+        display_started = true;
 
-    persistence::last_view = current_view;
+        display_task::display(current_view);
+    }
+#endif
 
-    ESP_LOGI(TAG, "going to sleep now");
+    const uint64_t now = static_cast<uint64_t>(time(nullptr));
+    const uint32_t interval =
+        scheduler::backoff_interval(persistence::backoff, scheduler::update_interval(persistence::activity, now));
+#if MODBUS_SOURCE
+    persistence::ts_next_network_update = now + interval;
+#else
+    persistence::ts_next_network_update = cloud_phase::align(persistence::cloud_refresh, now + interval, interval);
+#endif
 
-    for (auto domain : {ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_DOMAIN_RTC_FAST_MEM, ESP_PD_DOMAIN_VDDSDIO})
-        esp_sleep_pd_config(domain, ESP_PD_OPTION_AUTO);
+#if !UDP_LOGGING
+    network::stop();
+#endif
+    if (display_started) display_task::wait();
 
-    esp_deep_sleep(SLEEP_SECONDS * 1000000);
+    enter_deep_sleep();
 }
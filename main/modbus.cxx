@@ -0,0 +1,186 @@
+#include "modbus.h"
+
+#include <esp_log.h>
+#include <fcntl.h>
+#include <lwip/inet.h>
+#include <lwip/sockets.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const char* TAG = "modbus";
+
+constexpr uint8_t FUNCTION_READ_HOLDING_REGISTERS = 0x03;
+constexpr uint8_t EXCEPTION_FLAG = 0x80;
+
+constexpr size_t MBAP_HEADER_LEN = 7;
+
+int socket_fd{-1};
+uint16_t transaction_id{0};
+
+// Receives exactly len bytes (the socket has a receive timeout)
+modbus::status_t receive(uint8_t* buffer, size_t len) {
+    while (len > 0) {
+        const ssize_t received = recv(socket_fd, buffer, len, 0);
+
+        if (received == 0) {
+            ESP_LOGE(TAG, "connection closed by peer");
+            return modbus::status_t::failed;
+        }
+
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return modbus::status_t::timeout;
+
+            ESP_LOGE(TAG, "recv failed: %i", errno);
+            return modbus::status_t::failed;
+        }
+
+        buffer += received;
+        len -= received;
+    }
+
+    return modbus::status_t::ok;
+}
+
+uint16_t get_u16(const uint8_t* data) { return (data[0] << 8) | data[1]; }
+
+void put_u16(uint8_t* data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value;
+}
+
+}  // namespace
+
+modbus::status_t modbus::connect(const char* ip, uint16_t port, uint32_t timeout_msec) {
+    disconnect();
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr(ip);
+    address.sin_port = htons(port);
+
+    socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_fd < 0) {
+        ESP_LOGE(TAG, "cannot open TCP socket");
+        return status_t::failed;
+    }
+
+    // Connect without blocking in order to apply the timeout
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    if (::connect(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 && errno != EINPROGRESS) {
+        ESP_LOGE(TAG, "connect to %s:%u failed: %i", ip, port, errno);
+        disconnect();
+
+        return status_t::failed;
+    }
+
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(socket_fd, &write_fds);
+
+    timeval timeout = {.tv_sec = static_cast<time_t>(timeout_msec / 1000),
+                       .tv_usec = static_cast<suseconds_t>((timeout_msec % 1000) * 1000)};
+
+    const int ready = select(socket_fd + 1, nullptr, &write_fds, nullptr, &timeout);
+
+    if (ready == 0) {
+        ESP_LOGE(TAG, "connect to %s:%u timed out", ip, port);
+        disconnect();
+
+        return status_t::timeout;
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+
+    if (ready < 0 || getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+        ESP_LOGE(TAG, "connect to %s:%u failed: %i", ip, port, error);
+        disconnect();
+
+        return status_t::failed;
+    }
+
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) & ~O_NONBLOCK);
+
+    set_timeout(timeout_msec);
+
+    ESP_LOGI(TAG, "connected to %s:%u", ip, port);
+
+    return status_t::ok;
+}
+
+void modbus::disconnect() {
+    if (socket_fd < 0) return;
+
+    close(socket_fd);
+    socket_fd = -1;
+}
+
+void modbus::set_timeout(uint32_t timeout_msec) {
+    if (socket_fd < 0) return;
+
+    const timeval timeout = {.tv_sec = static_cast<time_t>(timeout_msec / 1000),
+                             .tv_usec = static_cast<suseconds_t>((timeout_msec % 1000) * 1000)};
+
+    setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+modbus::status_t modbus::read_registers(uint8_t unit, uint16_t address, uint16_t count, uint16_t* registers) {
+    if (socket_fd < 0 || count == 0 || count > MAX_REGISTERS) return status_t::failed;
+
+    uint8_t request[MBAP_HEADER_LEN + 5];
+
+    transaction_id++;
+
+    put_u16(request, transaction_id);
+    put_u16(request + 2, 0);  // protocol
+    put_u16(request + 4, 6);  // length of unit and PDU
+    request[6] = unit;
+    request[7] = FUNCTION_READ_HOLDING_REGISTERS;
+    put_u16(request + 8, address);
+    put_u16(request + 10, count);
+
+    if (send(socket_fd, request, sizeof(request), 0) != sizeof(request)) {
+        ESP_LOGE(TAG, "send failed: %i", errno);
+        return errno == EAGAIN || errno == EWOULDBLOCK ? status_t::timeout : status_t::failed;
+    }
+
+    // Header, function and byte count (or exception code)
+    uint8_t header[MBAP_HEADER_LEN + 2];
+
+    status_t status = receive(header, sizeof(header));
+    if (status != status_t::ok) return status;
+
+    if (get_u16(header) != transaction_id || get_u16(header + 2) != 0 || header[6] != unit) {
+        ESP_LOGE(TAG, "unexpected response header");
+        return status_t::invalid_response;
+    }
+
+    if (header[7] == (FUNCTION_READ_HOLDING_REGISTERS | EXCEPTION_FLAG)) {
+        ESP_LOGE(TAG, "reading %u registers at 0x%04x failed with exception %u", count, address, header[8]);
+        return status_t::exception;
+    }
+
+    if (header[7] != FUNCTION_READ_HOLDING_REGISTERS || header[8] != 2 * count ||
+        get_u16(header + 4) != 3 + 2 * count) {
+        ESP_LOGE(TAG, "unexpected response to reading %u registers at 0x%04x", count, address);
+        return status_t::invalid_response;
+    }
+
+    uint8_t data[2 * MAX_REGISTERS];
+
+    status = receive(data, 2 * count);
+    if (status != status_t::ok) return status;
+
+    for (uint16_t i = 0; i < count; i++) registers[i] = get_u16(data + 2 * i);
+
+    return status_t::ok;
+}
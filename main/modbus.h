@@ -0,0 +1,27 @@
+#ifndef _MODBUS_H_
+#define _MODBUS_H_
+
+#include <cstdint>
+
+// Minimal Modbus TCP client, just enough to read holding registers from the inverter
+namespace modbus {
+
+enum class status_t { ok, failed, timeout, exception, invalid_response };
+
+// Protocol limit of a single read
+constexpr uint16_t MAX_REGISTERS = 125;
+
+// The timeout applies to connecting, and to every read until set_timeout() is called
+status_t connect(const char* ip, uint16_t port, uint32_t timeout_msec);
+
+void disconnect();
+
+// Timeout of sending the request and of receiving the response of the following reads
+void set_timeout(uint32_t timeout_msec);
+
+// Function 0x03, the registers are returned in host byte order
+status_t read_registers(uint8_t unit, uint16_t address, uint16_t count, uint16_t* registers);
+
+}  // namespace modbus
+
+#endif  // _MODBUS_H_
@@ -3,15 +3,23 @@
 #include <esp_event.h>
 #include <esp_log.h>
 #include <esp_sntp.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 #include <freertos/event_groups.h>
+#include <mbedtls/md.h>
+#include <mbedtls/pkcs5.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 
+#include "clock_discipline.h"
 #include "config.h"
 #include "persistence.h"
 #include "udp_logging.h"
 
+using namespace std;
+
 namespace {
 
 const char* TAG = "network";
@@ -24,6 +32,11 @@ EventGroupHandle_t event_group_handle;
 
 esp_netif_t* iface;
 
+// System and monotonic time when the NTP query was started, and the offset SNTP stepped the system clock by
+int64_t ntp_start_time_usec;
+int64_t ntp_start_timer_usec;
+int64_t ntp_offset_usec;
+
 void on_wifi_sta_start(void*, esp_event_base_t, int32_t, void*) { ESP_ERROR_CHECK(esp_wifi_connect()); }
 
 void on_wifi_disconnect(void*, esp_event_base_t, int32_t, void*) {
@@ -49,7 +62,10 @@ void on_sta_got_ip(void*, esp_event_base_t, int32_t, void*) {
     xEventGroupSetBits(event_group_handle, event_bit::wifi_connected);
 }
 
-void on_sntp_sync_time(struct timeval*) {
+void on_sntp_sync_time(struct timeval* tv) {
+    ntp_offset_usec = tv->tv_sec * 1000000ll + tv->tv_usec -
+                      (ntp_start_time_usec + esp_timer_get_time() - ntp_start_timer_usec);
+
     ESP_LOGI(TAG, "NTP sync complete");
     xEventGroupSetBits(event_group_handle, event_bit::sntp_sync_complete);
 }
@@ -83,11 +99,41 @@ void store_dhcp_lease() {
     ESP_LOGI(TAG, "stored DHCP lease for reuse");
 }
 
+// WPA2-PSK derives the PMK from passphrase and SSID with 4096 rounds of PBKDF2-HMAC-SHA1. Doing this once and
+// passing the result as a 64 hex digit PSK saves the derivation on every wake.
+void derive_pmk() {
+    mbedtls_md_context_t md_context;
+    mbedtls_md_init(&md_context);
+
+    int result = mbedtls_md_setup(&md_context, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+
+    if (result == 0)
+        result = mbedtls_pkcs5_pbkdf2_hmac(&md_context, reinterpret_cast<const unsigned char*>(WIFI_PASSWORD),
+                                           strlen(WIFI_PASSWORD), reinterpret_cast<const unsigned char*>(WIFI_SSID),
+                                           strlen(WIFI_SSID), 4096, sizeof(persistence::stored_pmk),
+                                           persistence::stored_pmk);
+
+    mbedtls_md_free(&md_context);
+
+    if (result != 0) {
+        ESP_LOGE(TAG, "failed to derive PMK");
+        persistence::reset_pmk();
+
+        return;
+    }
+
+    persistence::pmk_set = true;
+    ESP_LOGI(TAG, "stored PMK for reuse");
+}
+
 void init_wifi() {
     ESP_ERROR_CHECK(esp_netif_init());
     iface = esp_netif_create_default_wifi_sta();
 
+#if !CONTINUOUS_MODE
+    // a long running DHCP client is needed to renew the lease in continuous mode
     if (persistence::ip_info_set()) restore_cached_dhcp_lease();
+#endif
 
     esp_netif_set_hostname(iface, HOSTNAME);
 
@@ -99,18 +145,42 @@ void init_wifi() {
     wifi_config_t wifi_config;
     memset(&wifi_config, 0, sizeof(wifi_config));
     strcpy(reinterpret_cast<char*>(wifi_config.sta.ssid), WIFI_SSID);
-    strcpy(reinterpret_cast<char*>(wifi_config.sta.password), WIFI_PASSWORD);
+
+    if (persistence::pmk_set) {
+        char psk[2 * sizeof(persistence::stored_pmk) + 1];
+        for (size_t i = 0; i < sizeof(persistence::stored_pmk); i++)
+            sprintf(psk + 2 * i, "%02x", persistence::stored_pmk[i]);
+
+        memcpy(wifi_config.sta.password, psk, sizeof(wifi_config.sta.password));
+        ESP_LOGI(TAG, "using cached PMK");
+    } else {
+        strcpy(reinterpret_cast<char*>(wifi_config.sta.password), WIFI_PASSWORD);
+    }
 
     if (persistence::bssid_set) {
         memcpy(wifi_config.sta.bssid, persistence::stored_bssid, sizeof(persistence::stored_bssid));
         wifi_config.sta.bssid_set = true;
+        wifi_config.sta.channel = persistence::stored_channel;
+
+        ESP_LOGI(TAG, "using cached BSSID on channel %u", persistence::stored_channel);
     }
 
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
+
+#if CONTINUOUS_MODE
+    // the radio sleeps between DTIM beacons while the association (and the API connection) is kept
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
+#endif
 }
 
 void ntp_sync_start() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+
+    ntp_start_time_usec = tv.tv_sec * 1000000ll + tv.tv_usec;
+    ntp_start_timer_usec = esp_timer_get_time();
+
     sntp_setoperatingmode(SNTP_OPMODE_POLL);
     sntp_setservername(0, NTP_SERVER);
     sntp_set_sync_mode(SNTP_SYNC_MODE_IMMED);
@@ -126,7 +196,7 @@ void network::init() {
     register_events();
 }
 
-network::result_t network::start() {
+network::result_t network::start(Deadline& deadline) {
     if (persistence::ts_last_dhcp_update != 0 &&
         static_cast<uint64_t>(time(nullptr)) - persistence::ts_last_dhcp_update >= 60 * TTL_DHCP_LEASE_MINUTES) {
         persistence::reset_ip_info();
@@ -134,38 +204,57 @@ network::result_t network::start() {
         ESP_LOGI(TAG, "DHCP lease TTL expired, removing stored lease");
     }
 
+    int64_t timestamp = esp_timer_get_time();
+    const uint32_t wifi_timeout = deadline.timeout(Deadline::Phase::wifi);
+
     init_wifi();
 
+    const uint32_t wifi_init_msec = (esp_timer_get_time() - timestamp) / 1000;
+
     EventBits_t bits;
     bits = xEventGroupWaitBits(event_group_handle, event_bit::wifi_connected | event_bit::wifi_disconnected, pdTRUE,
-                               pdFALSE, WIFI_TIMEOUT_MSEC / portTICK_PERIOD_MS);
+                               pdFALSE, (wifi_timeout - min(wifi_init_msec, wifi_timeout)) / portTICK_PERIOD_MS);
 
     if ((bits & event_bit::wifi_disconnected) != 0) {
         persistence::reset_bssid();
+        persistence::reset_pmk();
         return result_t::wifi_disconnected;
     }
 
+    // A timeout is recorded as a sample as well, so a timeout that has become too tight widens on the next wakes
+    deadline.record(Deadline::Phase::wifi, timestamp);
+
     if ((bits & wifi_connected) == 0) {
         persistence::reset_bssid();
+        persistence::reset_pmk();
         return result_t::wifi_timeout;
     }
 
     wifi_ap_record_t ap_info;
     esp_wifi_sta_get_ap_info(&ap_info);
     memcpy(persistence::stored_bssid, ap_info.bssid, sizeof(persistence::stored_bssid));
+    persistence::stored_channel = ap_info.primary;
     persistence::bssid_set = true;
 
-    if (persistence::ts_last_time_sync == 0 || static_cast<uint64_t>(time(nullptr)) - persistence::ts_last_time_sync >=
-                                                   MAX_TIME_WITHOUT_TIME_SYNC_MINUTES * 60) {
+    // SAE (WPA3) does not work with a precomputed PSK
+    if (!persistence::pmk_set &&
+        (ap_info.authmode == WIFI_AUTH_WPA2_PSK || ap_info.authmode == WIFI_AUTH_WPA_WPA2_PSK ||
+         ap_info.authmode == WIFI_AUTH_WPA_PSK))
+        derive_pmk();
+
+    if (clock_discipline::needs_sync()) {
+        timestamp = esp_timer_get_time();
         ntp_sync_start();
 
         bits = xEventGroupWaitBits(event_group_handle, event_bit::sntp_sync_complete, pdTRUE, pdFAIL,
-                                   NTP_TIMEOUT_MSEC / portTICK_PERIOD_MS);
+                                   deadline.timeout(Deadline::Phase::ntp) / portTICK_PERIOD_MS);
+
+        deadline.record(Deadline::Phase::ntp, timestamp);
 
         if ((bits & event_bit::sntp_sync_complete) == 0) return result_t::sntp_timeout;
 
         sntp_stop();
-        persistence::ts_last_time_sync = static_cast<uint64_t>(time(nullptr));
+        clock_discipline::observe(ntp_offset_usec, clock_discipline::NTP_SIGMA_USEC, ntp_offset_usec);
     } else {
         ESP_LOGI(TAG, "skipping NTP update");
     }
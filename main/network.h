@@ -1,13 +1,15 @@
 #ifndef _NETWORK_H_
 #define _NETWORK_H_
 
+#include "deadline.h"
+
 namespace network {
 
 enum class result_t { ok, wifi_timeout, wifi_disconnected, sntp_timeout };
 
 void init();
 
-result_t start();
+result_t start(Deadline& deadline);
 
 void stop();
 
@@ -13,10 +13,13 @@ RTC_NOINIT_ATTR view::model_t persistence::last_view;
 
 RTC_NOINIT_ATTR uint64_t persistence::ts_first_update;
 RTC_NOINIT_ATTR uint64_t persistence::ts_last_request_accumulated_power;
-RTC_NOINIT_ATTR uint64_t persistence::ts_last_time_sync;
 RTC_NOINIT_ATTR uint64_t persistence::ts_last_update_current_power;
 RTC_NOINIT_ATTR uint64_t persistence::ts_last_update_accumulated_power;
 RTC_NOINIT_ATTR uint64_t persistence::ts_last_dhcp_update;
+RTC_NOINIT_ATTR uint64_t persistence::ts_last_dns_update;
+RTC_NOINIT_ATTR uint64_t persistence::ts_next_network_update;
+
+RTC_NOINIT_ATTR bool persistence::backfill_pending;
 
 RTC_NOINIT_ATTR uint8_t persistence::view_counter;
 
@@ -26,8 +29,25 @@ RTC_NOINIT_ATTR esp_netif_dns_info_t persistence::stored_dns_info_backup;
 RTC_NOINIT_ATTR esp_netif_dns_info_t persistence::stored_dns_info_fallback;
 
 RTC_NOINIT_ATTR uint8_t persistence::stored_bssid[6];
+RTC_NOINIT_ATTR uint8_t persistence::stored_channel;
 RTC_NOINIT_ATTR bool persistence::bssid_set;
 
+RTC_NOINIT_ATTR uint8_t persistence::stored_pmk[32];
+RTC_NOINIT_ATTR bool persistence::pmk_set;
+
+RTC_NOINIT_ATTR uint32_t persistence::stored_server_address;
+
+RTC_NOINIT_ATTR api::energy_baseline_t persistence::energy_baseline;
+
+RTC_NOINIT_ATTR Http2TlsCache persistence::tls_cache;
+RTC_NOINIT_ATTR Http2LatencyEstimate persistence::api_latency;
+RTC_NOINIT_ATTR phase_latencies_t persistence::phase_latencies;
+RTC_NOINIT_ATTR clock_discipline::model_t persistence::clock_model;
+RTC_NOINIT_ATTR scheduler::activity_t persistence::activity;
+RTC_NOINIT_ATTR scheduler::backoff_t persistence::backoff;
+RTC_NOINIT_ATTR cloud_phase::state_t persistence::cloud_refresh;
+RTC_NOINIT_ATTR timeseries::ring_t persistence::readings;
+
 void persistence::init() {
     if (esp_reset_reason() == ESP_RST_DEEPSLEEP) return;
 
@@ -40,6 +60,7 @@ void persistence::init() {
                  .request_status_current_power = api::request_status_t::ok,
                  .request_status_accumulated_power = api::request_status_t::ok,
                  .epoch = 0,
+                 .ts_current_power = 0,
                  .power_pv_w = -1,
                  .power_pv_accumulated_kwh = -1,
                  .load_w = -1,
@@ -48,16 +69,32 @@ void persistence::init() {
                  .power_network_accumulated_kwh = -1,
                  .charge = -1};
 
+    history::clear(last_view.history);
+    energy_baseline.day = -1;
+    energy_baseline.last_epoch = 0;
+    scheduler::clear(activity);
+    scheduler::clear(backoff);
+    cloud_phase::clear(cloud_refresh);
+    timeseries::clear(readings);
+
     ts_first_update = 0;
     ts_last_request_accumulated_power = 0;
-    ts_last_time_sync = 0;
     view_counter = 0;
     ts_last_update_current_power = 0;
     ts_last_update_accumulated_power = 0;
     ts_last_dhcp_update = 0;
+    ts_next_network_update = 0;
+    backfill_pending = false;
+
+    api_latency.clear();
+    phase_latencies.clear();
+    clock_model.clear();
 
     reset_ip_info();
     reset_bssid();
+    reset_pmk();
+    reset_server_address();
+    reset_tls_cache();
 }
 
 void persistence::reset_ip_info() {
@@ -75,5 +112,18 @@ bool persistence::ip_info_set() {
 
 void persistence::reset_bssid() {
     memset(stored_bssid, 0, sizeof(stored_bssid));
+    stored_channel = 0;
     bssid_set = false;
 }
+
+void persistence::reset_pmk() {
+    memset(stored_pmk, 0, sizeof(stored_pmk));
+    pmk_set = false;
+}
+
+void persistence::reset_server_address() {
+    stored_server_address = 0;
+    ts_last_dns_update = 0;
+}
+
+void persistence::reset_tls_cache() { tls_cache.clear(); }
@@ -3,8 +3,17 @@
 
 #include <esp_netif.h>
 
+#include <cstddef>
 #include <cstdint>
 
+#include "clock_discipline.h"
+#include "cloud_phase.h"
+#include "config.h"
+#include "deadline.h"
+#include "display/glyph_cache.h"
+#include "http2/http2_connection.h"
+#include "scheduler.h"
+#include "timeseries.h"
 #include "view.h"
 
 namespace persistence {
@@ -13,10 +22,14 @@ extern view::model_t last_view;
 
 extern uint64_t ts_first_update;
 extern uint64_t ts_last_request_accumulated_power;
-extern uint64_t ts_last_time_sync;
 extern uint64_t ts_last_update_current_power;
 extern uint64_t ts_last_update_accumulated_power;
 extern uint64_t ts_last_dhcp_update;
+extern uint64_t ts_last_dns_update;
+extern uint64_t ts_next_network_update;
+
+// Set once a gap in the readings has been detected, until a backfill succeeded
+extern bool backfill_pending;
 
 extern uint8_t view_counter;
 
@@ -26,8 +39,47 @@ extern esp_netif_dns_info_t stored_dns_info_backup;
 extern esp_netif_dns_info_t stored_dns_info_fallback;
 
 extern uint8_t stored_bssid[6];
+extern uint8_t stored_channel;
 extern bool bssid_set;
 
+extern uint8_t stored_pmk[32];
+extern bool pmk_set;
+
+extern uint32_t stored_server_address;
+
+extern api::energy_baseline_t energy_baseline;
+
+extern Http2TlsCache tls_cache;
+extern Http2LatencyEstimate api_latency;
+extern phase_latencies_t phase_latencies;
+extern clock_discipline::model_t clock_model;
+extern scheduler::activity_t activity;
+extern scheduler::backoff_t backoff;
+extern cloud_phase::state_t cloud_refresh;
+extern timeseries::ring_t readings;
+
+// Everything above is kept in RTC slow memory (RTC_NOINIT_ATTR), along with the charts and the glyph cache. Their types
+// are trivial so that they survive deep sleep untouched, on any other reset the owning module's init() clears them.
+// The ESP32 has 8 KB of it, of which the bootloader, the IDF's own RTC data and the alignment of the variables take
+// some.
+constexpr size_t RTC_BYTES =
+    sizeof(last_view) + sizeof(ts_first_update) + sizeof(ts_last_request_accumulated_power) +
+    sizeof(ts_last_update_current_power) + sizeof(ts_last_update_accumulated_power) + sizeof(ts_last_dhcp_update) +
+    sizeof(ts_last_dns_update) + sizeof(ts_next_network_update) + sizeof(backfill_pending) + sizeof(view_counter) +
+    sizeof(stored_ip_info) + sizeof(stored_dns_info_main) + sizeof(stored_dns_info_backup) +
+    sizeof(stored_dns_info_fallback) + sizeof(stored_bssid) + sizeof(stored_channel) + sizeof(bssid_set) +
+    sizeof(stored_pmk) + sizeof(pmk_set) + sizeof(stored_server_address) + sizeof(energy_baseline) + sizeof(tls_cache) +
+    sizeof(api_latency) + sizeof(phase_latencies) + sizeof(clock_model) + sizeof(activity) + sizeof(backoff) +
+    sizeof(cloud_refresh) + sizeof(readings);
+
+constexpr size_t RTC_SLOW_MEMORY_BYTES = 8 * 1024;
+constexpr size_t RTC_RESERVED_BYTES = 512;
+
+static_assert(RTC_BYTES + view::RTC_BYTES +
+                      glyph_cache::rtc_bytes(GLYPH_CACHE_SIZE, GLYPH_CACHE_ENTRIES, GLYPH_CACHE_GHOSTS) <=
+                  RTC_SLOW_MEMORY_BYTES - RTC_RESERVED_BYTES,
+              "RTC_NOINIT_ATTR data exceeds the RTC slow memory");
+
 void init();
 
 void reset_ip_info();
@@ -36,6 +88,12 @@ bool ip_info_set();
 
 void reset_bssid();
 
+void reset_pmk();
+
+void reset_server_address();
+
+void reset_tls_cache();
+
 }  // namespace persistence
 
 #endif  // _PERSISTENCE_H_
@@ -0,0 +1,157 @@
+#include "scheduler.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+#include "config.h"
+
+using namespace std;
+
+namespace {
+
+const char* TAG = "scheduler";
+
+constexpr float VARIANCE_SMOOTHING = 0.25;
+
+constexpr double DEG = M_PI / 180;
+
+enum class sun_t { rises, always_up, always_down };
+
+// NOAA's approximate solar equations. Sunrise and sunset (as epochs) of the UTC date that starts at day_start.
+sun_t sun_times(int64_t day_start, int64_t& sunrise, int64_t& sunset) {
+    const time_t time = day_start;
+    struct tm utc;
+    gmtime_r(&time, &utc);
+
+    const double gamma = 2 * M_PI / 365 * utc.tm_yday;
+
+    const double eqtime = 229.18 * (0.000075 + 0.001868 * cos(gamma) - 0.032077 * sin(gamma) -
+                                    0.014615 * cos(2 * gamma) - 0.040849 * sin(2 * gamma));
+    const double decl = 0.006918 - 0.399912 * cos(gamma) + 0.070257 * sin(gamma) - 0.006758 * cos(2 * gamma) +
+                        0.000907 * sin(2 * gamma) - 0.002697 * cos(3 * gamma) + 0.00148 * sin(3 * gamma);
+
+    // 90.833 degrees zenith accounts for refraction and the size of the sun's disc
+    const double cos_ha = cos(90.833 * DEG) / (cos(LATITUDE * DEG) * cos(decl)) - tan(LATITUDE * DEG) * tan(decl);
+
+    if (cos_ha > 1) return sun_t::always_down;
+    if (cos_ha < -1) return sun_t::always_up;
+
+    const double ha = acos(cos_ha) / DEG;
+
+    sunrise = day_start + lround((720 - 4 * (LONGITUDE + ha) - eqtime) * 60);
+    sunset = day_start + lround((720 - 4 * (LONGITUDE - ha) - eqtime) * 60);
+
+    return sun_t::rises;
+}
+
+// Whether the sun is up at epoch, otherwise the seconds until it rises (0 if it does not rise within a day)
+bool is_day(uint64_t epoch, int64_t& seconds_to_sunrise) {
+    const int64_t today = epoch - epoch % 86400;
+
+    seconds_to_sunrise = 0;
+
+    // Depending on the longitude, daylight may span two UTC dates
+    for (int64_t day = today - 86400; day <= today + 86400; day += 86400) {
+        int64_t sunrise, sunset;
+
+        switch (sun_times(day, sunrise, sunset)) {
+            case sun_t::always_up:
+                if (day == today) return true;
+                break;
+
+            case sun_t::always_down:
+                break;
+
+            case sun_t::rises:
+                if (static_cast<int64_t>(epoch) >= sunrise && static_cast<int64_t>(epoch) < sunset) return true;
+                if (sunrise > static_cast<int64_t>(epoch) && seconds_to_sunrise == 0)
+                    seconds_to_sunrise = sunrise - epoch;
+                break;
+        }
+    }
+
+    return false;
+}
+
+}  // namespace
+
+void scheduler::clear(activity_t& activity) {
+    activity.epoch = 0;
+    activity.pv_w = activity.load_w = 0;
+
+    // Start out at the shortest interval
+    activity.variance = SCHEDULE_TOLERANCE_W * SCHEDULE_TOLERANCE_W;
+}
+
+void scheduler::record(activity_t& activity, uint64_t epoch, float pv_w, float load_w) {
+    if (pv_w < 0 || load_w < 0) return;
+
+    if (activity.epoch != 0 && epoch > activity.epoch) {
+        const float minutes = max((epoch - activity.epoch) / 60.f, 1.f);
+        const float change = (pv_w - activity.pv_w) * (pv_w - activity.pv_w) +
+                             (load_w - activity.load_w) * (load_w - activity.load_w);
+
+        activity.variance += VARIANCE_SMOOTHING * (change / minutes - activity.variance);
+    }
+
+    activity.epoch = epoch;
+    activity.pv_w = pv_w;
+    activity.load_w = load_w;
+}
+
+uint32_t scheduler::update_interval(const activity_t& activity, uint64_t epoch) {
+    int64_t seconds_to_sunrise;
+    const bool day = is_day(epoch, seconds_to_sunrise);
+
+    // PV and load are taken as random walks: the time until they are expected to have moved by the tolerance
+    const float steady_seconds = activity.variance > 0
+                                     ? 60 * SCHEDULE_TOLERANCE_W * SCHEDULE_TOLERANCE_W / activity.variance
+                                     : NETWORK_UPDATE_NIGHT_MAX_SECONDS;
+
+    uint32_t seconds =
+        clamp(steady_seconds, static_cast<float>(NETWORK_UPDATE_SECONDS),
+              static_cast<float>(day ? NETWORK_UPDATE_DAY_MAX_SECONDS : NETWORK_UPDATE_NIGHT_MAX_SECONDS));
+
+    // Be up for the first PV of the day
+    if (!day && seconds_to_sunrise > 0)
+        seconds = max<int64_t>(min<int64_t>(seconds, seconds_to_sunrise), NETWORK_UPDATE_SECONDS);
+
+    ESP_LOGI(TAG, "%s, variance %.0f W^2/min, next network update in %lu sec", day ? "day" : "night", activity.variance,
+             seconds);
+
+    return seconds;
+}
+
+void scheduler::clear(backoff_t& backoff) {
+    backoff.failure = failure_t::none;
+    backoff.count = 0;
+}
+
+bool scheduler::record(backoff_t& backoff, failure_t failure) {
+    const bool repeated = failure != failure_t::none && failure == backoff.failure;
+
+    if (repeated) {
+        if (backoff.count < UINT8_MAX) backoff.count++;
+    } else {
+        backoff.failure = failure;
+        backoff.count = failure == failure_t::none ? 0 : 1;
+    }
+
+    return repeated;
+}
+
+uint32_t scheduler::backoff_interval(const backoff_t& backoff, uint32_t interval) {
+    // Retrying does not help against API errors (and rate limits have their own interval)
+    if (backoff.count == 0 || backoff.failure == failure_t::api) return interval;
+
+    const uint32_t seconds =
+        max(interval, min<uint32_t>(NETWORK_UPDATE_SECONDS << min<uint8_t>(backoff.count, 16), BACKOFF_MAX_SECONDS));
+
+    ESP_LOGI(TAG, "%u consecutive failures of class %u, backing off to %lu sec", backoff.count,
+             static_cast<uint8_t>(backoff.failure), seconds);
+
+    return seconds;
+}
@@ -0,0 +1,41 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <cstdint>
+
+// Picks the interval of the network updates. Data is fetched every NETWORK_UPDATE_SECONDS while PV and load change
+// quickly, and less often (up to NETWORK_UPDATE_DAY_MAX_SECONDS or NETWORK_UPDATE_NIGHT_MAX_SECONDS) while they are
+// steady. Day and night follow sunrise and sunset at LATITUDE / LONGITUDE. Consecutive failures on the network side
+// back off exponentially, up to BACKOFF_MAX_SECONDS.
+namespace scheduler {
+
+enum class failure_t : uint8_t { none, wifi, time_sync, connection, api };
+
+struct activity_t {
+    uint64_t epoch;  // of the last reading, 0 if none
+    float pv_w;
+    float load_w;
+    float variance;  // smoothed squared change of PV and load per minute (W^2 / min)
+};
+
+struct backoff_t {
+    failure_t failure;
+    uint8_t count;  // consecutive failures of this class
+};
+
+void clear(activity_t& activity);
+
+void record(activity_t& activity, uint64_t epoch, float pv_w, float load_w);
+
+uint32_t update_interval(const activity_t& activity, uint64_t epoch);
+
+void clear(backoff_t& backoff);
+
+// Returns whether the failure repeats the previous one
+bool record(backoff_t& backoff, failure_t failure);
+
+uint32_t backoff_interval(const backoff_t& backoff, uint32_t interval);
+
+}  // namespace scheduler
+
+#endif  // _SCHEDULER_H_
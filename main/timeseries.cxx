@@ -0,0 +1,227 @@
+#include "timeseries.h"
+
+#include <esp_log.h>
+#include <nvs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+const char* TAG = "timeseries";
+
+const char* NVS_NAMESPACE = "timeseries";
+
+// Key, one delta per field and the length byte
+constexpr size_t MAX_RECORD_LEN = 10 + 5 * timeseries::FIELDS + 1;
+
+constexpr size_t HEADER_LEN = offsetof(timeseries::block_t, data);
+
+// Order of the fields in a record, with their fixed-point step
+float timeseries::sample_t::*const FIELD_MEMBERS[timeseries::FIELDS] = {
+    &timeseries::sample_t::pv_w, &timeseries::sample_t::load_w, &timeseries::sample_t::soc,
+    &timeseries::sample_t::pgrid_w, &timeseries::sample_t::pbat_w};
+
+constexpr float FIELD_STEPS[timeseries::FIELDS] = {TIMESERIES_POWER_STEP_W, TIMESERIES_POWER_STEP_W,
+                                                   TIMESERIES_SOC_STEP, TIMESERIES_POWER_STEP_W,
+                                                   TIMESERIES_POWER_STEP_W};
+
+uint32_t zigzag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+
+int32_t unzigzag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+size_t put_varint(uint8_t* buffer, uint64_t value) {
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        buffer[len++] = value | 0x80;
+        value >>= 7;
+    }
+
+    buffer[len++] = value;
+    return len;
+}
+
+uint64_t get_varint(const uint8_t* data, uint16_t& position) {
+    uint64_t value = 0;
+
+    for (uint8_t shift = 0; shift < 64; shift += 7) {
+        const uint8_t byte = data[position++];
+
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+
+    return value;
+}
+
+// Decodes the record at position into its time delta and field deltas
+void get_record(const uint8_t* data, uint16_t position, uint64_t& time_delta, int32_t (&deltas)[timeseries::FIELDS]) {
+    const uint64_t key = get_varint(data, position);
+
+    time_delta = key >> timeseries::FIELDS;
+
+    for (uint8_t field = 0; field < timeseries::FIELDS; field++)
+        deltas[field] = key & (1u << field) ? unzigzag(get_varint(data, position)) : 0;
+}
+
+// Reads up to max_samples of the samples in the block, newest first
+size_t read_block(const timeseries::block_t& block, timeseries::sample_t* samples, size_t max_samples) {
+    const size_t count = min<size_t>(max_samples, block.count);
+
+    uint64_t epoch = block.epoch;
+    int32_t values[timeseries::FIELDS];
+    copy_n(block.values, timeseries::FIELDS, values);
+
+    uint16_t position = block.used;
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i].epoch = epoch;
+        for (uint8_t field = 0; field < timeseries::FIELDS; field++)
+            samples[i].*FIELD_MEMBERS[field] = values[field] * FIELD_STEPS[field];
+
+        if (i + 1 == count) return count;
+
+        // Undo the record that led to this sample
+        const uint8_t len = block.data[position - 1];
+        if (len == 0 || len >= position) {
+            ESP_LOGE(TAG, "invalid record at %u", position);
+            return i + 1;
+        }
+
+        position -= len + 1;
+
+        uint64_t time_delta;
+        int32_t deltas[timeseries::FIELDS];
+        get_record(block.data, position, time_delta, deltas);
+
+        epoch -= time_delta;
+        for (uint8_t field = 0; field < timeseries::FIELDS; field++) values[field] -= deltas[field];
+    }
+
+    return count;
+}
+
+void block_key(char (&key)[16], uint8_t slot) { snprintf(key, sizeof(key), "block%u", slot); }
+
+// Writes the full open block to the next NVS slot, replacing the oldest stored block once all slots are taken
+void store(timeseries::ring_t& ring) {
+    const uint8_t slot = ring.stored == 0 ? 0 : (ring.newest + 1) % TIMESERIES_NVS_BLOCKS;
+
+    char key[16];
+    block_key(key, slot);
+
+    nvs_handle_t handle;
+    esp_err_t result = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+
+    if (result == ESP_OK) {
+        result = nvs_set_blob(handle, key, &ring.open, HEADER_LEN + ring.open.used);
+        if (result == ESP_OK) result = nvs_commit(handle);
+
+        nvs_close(handle);
+    }
+
+    // Blocks do not depend on each other, a block that could not be stored is a gap
+    if (result == ESP_OK) {
+        ring.newest = slot;
+        ring.stored = min(ring.stored + 1, TIMESERIES_NVS_BLOCKS);
+
+        ESP_LOGI(TAG, "stored %u samples as %s", ring.open.count, key);
+    } else {
+        ESP_LOGE(TAG, "failed to store %u samples: %s", ring.open.count, esp_err_to_name(result));
+    }
+
+    ring.open.used = ring.open.count = 0;
+}
+
+bool load(nvs_handle_t handle, uint8_t slot, timeseries::block_t& block) {
+    char key[16];
+    block_key(key, slot);
+
+    size_t size = sizeof(block);
+    const esp_err_t result = nvs_get_blob(handle, key, &block, &size);
+
+    if (result != ESP_OK || size < HEADER_LEN || size != HEADER_LEN + block.used) {
+        ESP_LOGE(TAG, "cannot load %s: %s", key, esp_err_to_name(result));
+        return false;
+    }
+
+    return true;
+}
+
+}  // namespace
+
+void timeseries::clear(ring_t& ring) {
+    ring.open.epoch = 0;
+    fill_n(ring.open.values, FIELDS, 0);
+    ring.open.used = ring.open.count = 0;
+    ring.newest = ring.stored = 0;
+}
+
+void timeseries::append(ring_t& ring, const sample_t& sample) {
+    block_t& block = ring.open;
+
+    // The first record is relative to an all-zero sample at its own time
+    if (block.count == 0 && ring.stored == 0) block.epoch = sample.epoch;
+
+    uint8_t record[MAX_RECORD_LEN];
+    uint8_t deltas[5 * FIELDS];
+    size_t deltas_len = 0;
+    uint8_t changed = 0;
+    int32_t values[FIELDS];
+
+    for (uint8_t field = 0; field < FIELDS; field++) {
+        values[field] = lroundf(sample.*FIELD_MEMBERS[field] / FIELD_STEPS[field]);
+        if (values[field] == block.values[field]) continue;
+
+        changed |= 1u << field;
+        deltas_len += put_varint(deltas + deltas_len, zigzag(values[field] - block.values[field]));
+    }
+
+    // A clock that has been set back yields a zero time delta
+    const uint64_t time_delta = sample.epoch > block.epoch ? sample.epoch - block.epoch : 0;
+
+    size_t len = put_varint(record, (time_delta << FIELDS) | changed);
+    copy_n(deltas, deltas_len, record + len);
+    len += deltas_len;
+    record[len] = len;
+    len++;
+
+    // The stored block ends with the sample before this one
+    if (block.used + len > TIMESERIES_BLOCK_BYTES) store(ring);
+
+    copy_n(record, len, block.data + block.used);
+    block.used += len;
+    block.count++;
+
+    block.epoch += time_delta;
+    copy_n(values, FIELDS, block.values);
+
+    ESP_LOGD(TAG, "%u byte record, %u samples in %u bytes, %u stored blocks", len, block.count, block.used,
+             ring.stored);
+}
+
+size_t timeseries::read_last(const ring_t& ring, sample_t* samples, size_t max_samples) {
+    size_t count = read_block(ring.open, samples, max_samples);
+    if (count == max_samples || ring.stored == 0) return count;
+
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return count;
+
+    block_t block;
+
+    for (uint8_t i = 0; i < ring.stored && count < max_samples; i++) {
+        const uint8_t slot = (ring.newest + TIMESERIES_NVS_BLOCKS - i) % TIMESERIES_NVS_BLOCKS;
+        if (!load(handle, slot, block)) break;
+
+        count += read_block(block, samples + count, max_samples - count);
+    }
+
+    nvs_close(handle);
+
+    return count;
+}
@@ -0,0 +1,62 @@
+#ifndef _TIMESERIES_H_
+#define _TIMESERIES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "config.h"
+
+// The readings of every update, delta-encoded into blocks. A record holds the time since the previous one and the
+// fields that changed, as fixed-point deltas in zigzag varints:
+//
+//   key (time delta << FIELDS | changed fields) | delta of every changed field | length of key and deltas
+//
+// The open block is kept in RTC memory. Once it is full it is written to NVS, which keeps the last
+// TIMESERIES_NVS_BLOCKS blocks, and the next one is started. Every block holds its newest sample in full, older ones
+// are reconstructed by walking back over the trailing lengths. Appending is O(1) (plus a flash write per block),
+// every step back is O(1), so reading the last N samples is O(N) with a flash read per stored block.
+//
+// A record takes 3 to 19 bytes, at one-minute cadence mostly 5 to 9 (power changes by less than 640 W, the state of
+// charge rarely). The blocks hold a day at one-minute cadence as long as records average up to DAY_RECORD_BYTES,
+// older samples are dropped a block at a time.
+namespace timeseries {
+
+constexpr uint8_t FIELDS = 5;
+constexpr size_t DAY_RECORD_BYTES = 10;
+
+struct sample_t {
+    uint64_t epoch;
+    float pv_w;
+    float load_w;
+    float soc;
+    float pgrid_w;
+    float pbat_w;
+};
+
+struct block_t {
+    uint64_t epoch;          // of the newest sample
+    int32_t values[FIELDS];  // of the newest sample, fixed point
+    uint16_t used;
+    uint16_t count;
+    uint8_t data[TIMESERIES_BLOCK_BYTES];
+};
+
+struct ring_t {
+    block_t open;
+    uint8_t newest;  // NVS slot of the newest stored block
+    uint8_t stored;  // number of stored blocks
+};
+
+static_assert(TIMESERIES_BLOCK_BYTES < 0x10000 && TIMESERIES_NVS_BLOCKS < 0x100);
+static_assert((TIMESERIES_NVS_BLOCKS + 1) * TIMESERIES_BLOCK_BYTES >= 24 * 60 * DAY_RECORD_BYTES);
+
+void clear(ring_t& ring);
+
+void append(ring_t& ring, const sample_t& sample);
+
+// Reads up to max_samples of the newest samples, newest first, and returns how many there were
+size_t read_last(const ring_t& ring, sample_t* samples, size_t max_samples);
+
+}  // namespace timeseries
+
+#endif  // _TIMESERIES_H_
@@ -1,7 +1,10 @@
 #include "view.h"
 
+#include <esp_attr.h>
 #include <esp_log.h>
 #include <esp_pm.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 
 #include <algorithm>
 #include <cstdlib>
@@ -11,7 +14,9 @@
 #include <string>
 
 #include "config.h"
+#include "display/column_chart.h"
 #include "display/font.h"
+#include "display/glyph_cache.h"
 #include "display/icon.h"
 
 using namespace std;
@@ -23,6 +28,15 @@ constexpr size_t STRING_BUFFER_SIZE = 256;
 
 char string_buffer[STRING_BUFFER_SIZE];
 
+using chart_t = ColumnChart<history::SLOTS, CHART_COLUMN_WIDTH, CHART_HEIGHT>;
+
+RTC_NOINIT_ATTR chart_t chart_pv;
+RTC_NOINIT_ATTR chart_t chart_load;
+
+esp_pm_lock_handle_t pm_lock;
+
+static_assert(sizeof(chart_pv) + sizeof(chart_load) == view::RTC_BYTES);
+
 const char* format_time(uint64_t timestamp) {
     static const char* weekdays[] = {SUNDAY, MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY, SATURDAY};
 
@@ -178,6 +192,16 @@ void draw_error(Adafruit_GFX& gfx, const view::model_t& model) {
     draw_error_message(gfx, sstream.str().c_str());
 }
 
+// Shown once the readings are at least a minute older than the displayed time
+void draw_data_age(Adafruit_GFX& gfx, const view::model_t& model) {
+    if (model.ts_current_power == 0 || model.epoch < model.ts_current_power + 60) return;
+
+    snprintf(string_buffer, STRING_BUFFER_SIZE, FORMAT_DATA_AGE, (model.epoch - model.ts_current_power) / 60);
+
+    gfx.setFont(nullptr);
+    gfx.writeRightJustified(400, has_error(model) ? 33 : 23, string_buffer);
+}
+
 void draw_battery_segment_top(Adafruit_GFX& gfx, uint32_t x, uint32_t y, uint32_t width, uint32_t radius, bool filled) {
     if (filled) {
         gfx.fillRoundRect(x, y, width, 50, radius, 1);
@@ -197,62 +221,101 @@ void draw_battery_segment_bottom(Adafruit_GFX& gfx, uint32_t x, uint32_t y, uint
     }
 }
 
-void draw_battery(Adafruit_GFX& gfx, uint32_t x, uint32_t y, uint32_t width, uint32_t radius, int32_t charge) {
+void draw_battery(Adafruit_GFX& gfx, Adafruit_GFX& fill, uint32_t x, uint32_t y, uint32_t width, uint32_t radius,
+                  int32_t charge) {
     gfx.drawRoundRect(x, y, width, 225, radius, 1);
 
     if (charge < 0) return;
 
-    draw_battery_segment_top(gfx, x + 5, y + 5, width - 10, 10, charge >= 75);
-    draw_battery_segment_middle(gfx, x + 5, y + 60, width - 10, charge >= 50);
-    draw_battery_segment_middle(gfx, x + 5, y + 115, width - 10, charge >= 25);
-    draw_battery_segment_bottom(gfx, x + 5, y + 170, width - 10, 10, charge > 0);
+    draw_battery_segment_top(fill, x + 5, y + 5, width - 10, 10, charge >= 75);
+    draw_battery_segment_middle(fill, x + 5, y + 60, width - 10, charge >= 50);
+    draw_battery_segment_middle(fill, x + 5, y + 115, width - 10, charge >= 25);
+    draw_battery_segment_bottom(fill, x + 5, y + 170, width - 10, 10, charge > 0);
 }
 
 void draw_status_icons(Adafruit_GFX& gfx, const view::model_t& model) {
     uint32_t x = 399;
 
     if (has_error(model)) {
-        x -= icon::warning_width;
-        gfx.drawXBitmap(x, 0, icon::warning_data, icon::warning_width, icon::warning_height, 1);
+        x -= icon::warning.width;
+        gfx.drawSprite(x, 0, icon::warning, 1);
     } else {
-        x -= icon::wifi_width;
-        gfx.drawXBitmap(x, 1, icon::wifi_data, icon::wifi_width, icon::wifi_height, 1);
+        x -= icon::wifi.width;
+        gfx.drawSprite(x, 1, icon::wifi, 1);
     }
 
     x -= 5;
 
     if (model.charging) {
-        x -= icon::flash_width;
-        gfx.drawXBitmap(x, 0, icon::flash_data, icon::flash_width, icon::flash_height, 1);
+        x -= icon::flash.width;
+        gfx.drawSprite(x, 0, icon::flash, 1);
 
         x -= 5;
     }
 
-    x -= icon::battery_width;
+    x -= icon::battery_full.width;
 
     switch (model.battery_status) {
         case view::battery_status_t::full:
-            gfx.drawXBitmap(x, 4, icon::battery_full_data, icon::battery_width, icon::battery_height, 1);
+            gfx.drawSprite(x, 4, icon::battery_full, 1);
             break;
 
         case view::battery_status_t::half:
-            gfx.drawXBitmap(x, 4, icon::battery_half_data, icon::battery_width, icon::battery_height, 1);
+            gfx.drawSprite(x, 4, icon::battery_half, 1);
             break;
 
         case view::battery_status_t::empty:
-            gfx.drawXBitmap(x, 4, icon::battery_empty_data, icon::battery_width, icon::battery_height, 1);
+            gfx.drawSprite(x, 4, icon::battery_empty, 1);
             break;
     }
 }
 
-}  // namespace
+uint16_t chart_scale(const history::day_t& history) {
+    uint16_t scale = CHART_MIN_SCALE_W;
+
+    for (uint16_t i = 0; i < history::SLOTS; i++) {
+        if (history.pv_w[i] != history::NO_DATA) scale = max(scale, history.pv_w[i]);
+        if (history.load_w[i] != history::NO_DATA) scale = max(scale, history.load_w[i]);
+    }
+
+    return (scale + CHART_SCALE_STEP_W - 1) / CHART_SCALE_STEP_W * CHART_SCALE_STEP_W;
+}
+
+uint16_t draw_chart(Adafruit_GFX& gfx, chart_t& chart, int16_t x, int16_t y, const uint16_t* samples, uint16_t scale) {
+    uint8_t heights[history::SLOTS];
 
-void view::render(Adafruit_GFX& gfx, const model_t& model) {
-    esp_pm_lock_handle_t pm_lock;
+    for (uint16_t i = 0; i < history::SLOTS; i++)
+        heights[i] =
+            samples[i] == history::NO_DATA ? 0 : (static_cast<uint32_t>(samples[i]) * CHART_HEIGHT + scale - 1) / scale;
 
+    const uint16_t redrawn = chart.update(heights);
+    chart.draw(gfx, x, y);
+
+    // time axis with a tick every 6 hours
+    gfx.drawFastHLine(x, y + CHART_HEIGHT, chart_t::width, 1);
+    for (uint8_t hour = 0; hour <= 24; hour += 6)
+        gfx.drawFastVLine(min(x + hour * chart_t::width / 24, x + chart_t::width - 1), y + CHART_HEIGHT + 1, 2, 1);
+
+    return redrawn;
+}
+
+}  // namespace
+
+void view::init() {
     esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "view lock", &pm_lock);
+
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP) return;
+
+    chart_pv.invalidate();
+    chart_load.invalidate();
+}
+
+void view::render(Adafruit_GFX& gfx, const model_t& model, Adafruit_GFX* gray_layer) {
     esp_pm_lock_acquire(pm_lock);
 
+    const int64_t timestamp = esp_timer_get_time();
+    const glyph_cache::stats_t glyph_cache_stats = glyph_cache::get_stats();
+
     gfx.setTextWrap(false);
 
     const char* formatted_time(format_time(model.epoch));
@@ -263,17 +326,23 @@ void view::render(Adafruit_GFX& gfx, const model_t& model) {
 
     draw_status_icons(gfx, model);
     draw_error(gfx, model);
+    draw_data_age(gfx, model);
 
     gfx.setFont(&font::freeSans18pt7b);
     gfx.write(0, 68, format_power(LABEL_PV, model.power_pv_w));
     gfx.setFont(&font::freeSans12pt7b);
     gfx.write(0, 96, format_accumulated_power_kwh(LABEL_PV_ACCUMULATED, model.power_pv_accumulated_kwh));
 
+    const uint16_t scale = chart_scale(model.history);
+    uint16_t columns_redrawn = draw_chart(gfx, chart_pv, 0, 104, model.history.pv_w, scale);
+
     gfx.setFont(&font::freeSans18pt7b);
     gfx.write(0, 150, format_power(LABEL_LOAD, model.load_w));
     gfx.setFont(&font::freeSans12pt7b);
     gfx.write(0, 178, format_accumulated_power_kwh(LABEL_LOAD_ACCUMULATED, model.load_accumulated_kwh));
 
+    columns_redrawn += draw_chart(gfx, chart_load, 0, 187, model.history.load_w, scale);
+
     gfx.setFont(&font::freeSans18pt7b);
     gfx.write(0, 234, format_accumulated_power_kwh(LABEL_SURPLUS, model.power_surplus_accumulated_kwh));
 
@@ -283,7 +352,15 @@ void view::render(Adafruit_GFX& gfx, const model_t& model) {
     gfx.setFont(&font::freeSans18pt7b);
     gfx.writeCentered(338, 68, format_charge(model.charge));
 
-    draw_battery(gfx, 285, 75, 115, 10, model.charge);
+    draw_battery(gfx, gray_layer ? *gray_layer : gfx, 285, 75, 115, 10, model.charge);
+
+    const glyph_cache::stats_t glyph_cache_stats_after = glyph_cache::get_stats();
+
+    ESP_LOGI(TAG, "render took %lli usec, glyph cache: %lu hits, %lu misses (total %lu / %lu), %u entries, %u bytes",
+             esp_timer_get_time() - timestamp, glyph_cache_stats_after.hits - glyph_cache_stats.hits,
+             glyph_cache_stats_after.misses - glyph_cache_stats.misses, glyph_cache_stats_after.hits,
+             glyph_cache_stats_after.misses, glyph_cache_stats_after.entries, glyph_cache_stats_after.bytes_used);
+    ESP_LOGI(TAG, "chart: %u columns redrawn, scale %u W", columns_redrawn, scale);
 
     esp_pm_lock_release(pm_lock);
 }
@@ -1,14 +1,21 @@
 #ifndef _VIEW_H_
 #define _VIEW_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include "api.h"
+#include "config.h"
 #include "display/adagfx.h"
+#include "display/column_chart.h"
+#include "history.h"
 #include "network.h"
 
 namespace view {
 
+// RTC memory taken by the PV and load charts, which are kept between renders
+constexpr size_t RTC_BYTES = 2 * sizeof(ColumnChart<history::SLOTS, CHART_COLUMN_WIDTH, CHART_HEIGHT>);
+
 enum class battery_status_t { full, half, empty };
 
 struct model_t {
@@ -21,6 +28,7 @@ struct model_t {
     api::request_status_t request_status_accumulated_power;
 
     uint64_t epoch;
+    uint64_t ts_current_power;  // epoch of the shown readings, 0 if there are none
 
     float power_pv_w;
     float power_pv_accumulated_kwh;
@@ -32,9 +40,15 @@ struct model_t {
     float power_network_accumulated_kwh;
 
     int32_t charge;
+
+    history::day_t history;
 };
 
-void render(Adafruit_GFX& gfx, const model_t& model);
+// Call once before the first render
+void init();
+
+// If a gray layer is passed, secondary elements are drawn there instead of gfx (to be composed in gray)
+void render(Adafruit_GFX& gfx, const model_t& model, Adafruit_GFX* gray_layer = nullptr);
 
 }  // namespace view
 
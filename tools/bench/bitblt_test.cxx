@@ -0,0 +1,98 @@
+// Compares bitblt::blit with a per-pixel reference over randomized offsets, sizes, strides and raster operations.
+// Source and destination are exact size allocations, so that reads or writes past a row end show up under ASan
+// (-DCMAKE_CXX_FLAGS=-fsanitize=address).
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "display/bitblt.h"
+
+namespace {
+
+constexpr int ITERATIONS = 200000;
+constexpr int16_t MAX_SIZE = 80;
+
+bool get_pixel(const uint8_t* buffer, uint16_t stride, int16_t x, int16_t y) {
+    return buffer[y * stride + (x >> 3)] & (0x80 >> (x & 0x07));
+}
+
+void set_pixel(uint8_t* buffer, uint16_t stride, int16_t x, int16_t y, bool value) {
+    uint8_t& byte = buffer[y * stride + (x >> 3)];
+    const uint8_t mask = 0x80 >> (x & 0x07);
+
+    byte = value ? byte | mask : byte & ~mask;
+}
+
+void reference(uint8_t* dst, uint16_t dst_stride, int16_t dst_x, int16_t dst_y, const uint8_t* src,
+               uint16_t src_stride, int16_t src_x, int16_t src_y, int16_t w, int16_t h, bitblt::rop_t rop) {
+    for (int16_t yy = 0; yy < h; yy++) {
+        for (int16_t xx = 0; xx < w; xx++) {
+            const bool s = get_pixel(src, src_stride, src_x + xx, src_y + yy);
+            const bool d = get_pixel(dst, dst_stride, dst_x + xx, dst_y + yy);
+
+            bool result = s;
+
+            switch (rop) {
+                case bitblt::rop_t::copy:
+                    break;
+
+                case bitblt::rop_t::set:
+                    result = d || s;
+                    break;
+
+                case bitblt::rop_t::clear:
+                    result = d && !s;
+                    break;
+
+                case bitblt::rop_t::toggle:
+                    result = d != s;
+                    break;
+            }
+
+            set_pixel(dst, dst_stride, dst_x + xx, dst_y + yy, result);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(29);
+    int mismatches = 0;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        const int16_t w = 1 + rng() % MAX_SIZE;
+        const int16_t h = 1 + rng() % 8;
+        const int16_t src_x = rng() % 24, src_y = rng() % 4;
+        const int16_t dst_x = rng() % 24, dst_y = rng() % 4;
+        const auto rop = static_cast<bitblt::rop_t>(rng() % 4);
+
+        // Rows end exactly at the last byte covered
+        const uint16_t src_stride = (src_x + w + 7) >> 3;
+        const uint16_t dst_stride = (dst_x + w + 7) >> 3;
+        const size_t src_size = src_stride * (src_y + h);
+        const size_t dst_size = dst_stride * (dst_y + h);
+
+        auto src = std::make_unique<uint8_t[]>(src_size);
+        auto dst = std::make_unique<uint8_t[]>(dst_size);
+        auto expected = std::make_unique<uint8_t[]>(dst_size);
+
+        for (size_t j = 0; j < src_size; j++) src[j] = rng();
+        for (size_t j = 0; j < dst_size; j++) dst[j] = expected[j] = rng();
+
+        bitblt::blit(dst.get(), dst_stride, dst_x, dst_y, src.get(), src_stride, src_x, src_y, w, h, rop);
+        reference(expected.get(), dst_stride, dst_x, dst_y, src.get(), src_stride, src_x, src_y, w, h, rop);
+
+        if (memcmp(dst.get(), expected.get(), dst_size) == 0) continue;
+
+        if (mismatches++ < 10)
+            printf("mismatch: src %i,%i dst %i,%i size %ix%i rop %i\n", src_x, src_y, dst_x, dst_y, w, h,
+                   static_cast<int>(rop));
+    }
+
+    printf("%i blits, %i mismatches\n", ITERATIONS, mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}
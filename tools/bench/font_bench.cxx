@@ -0,0 +1,136 @@
+// Compares the raw and the run-length encoded glyph format: bitmap size, and time to decode and draw every glyph of
+// the font into the framebuffer. Both formats are checked to draw the same pixels.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "display/adagfx.h"
+#include "display/font.h"
+#include "display/rle.h"
+
+namespace font {
+
+extern const GFXfont freeSerif24pt7bRle;
+extern const GFXfont freeSans24pt7bRle;
+extern const GFXfont freeSerif18pt7bRle;
+extern const GFXfont freeSans18pt7bRle;
+
+}  // namespace font
+
+namespace {
+
+constexpr size_t FRAMEBUFFER_SIZE = (400 * 300) >> 3;
+constexpr int ITERATIONS = 2000;
+
+struct font_pair_t {
+    const char* name;
+    const GFXfont* raw;
+    const GFXfont* rle;
+};
+
+// Length of an encoded glyph, following the decoder
+size_t rle_length(const uint8_t* data, uint8_t w, uint8_t h) {
+    const uint8_t* start = data;
+
+    for (uint8_t yy = 0; yy < h;) {
+        if (*data == 0) {
+            data++;
+            yy++;
+        } else if (*data < 0x10) {
+            yy += *data++;
+        } else {
+            data = rle::decode_row(data, w, [](uint8_t, uint8_t) {});
+            yy++;
+        }
+    }
+
+    return data - start;
+}
+
+size_t bitmap_size(const GFXfont& font) {
+    size_t size = 0;
+
+    for (uint16_t c = font.first; c <= font.last; c++) {
+        const GFXglyph& glyph = font.glyph[c - font.first];
+        const uint16_t offset = glyph.bitmapOffset & ~GFX_GLYPH_RLE;
+
+        const size_t len = glyph.bitmapOffset & GFX_GLYPH_RLE
+                               ? rle_length(font.bitmap + offset, glyph.width, glyph.height)
+                               : (glyph.width * glyph.height + 7) >> 3;
+
+        if (offset + len > size) size = offset + len;
+    }
+
+    return size;
+}
+
+// Every glyph of the font, line by line
+void draw_glyphs(Adafruit_GFX& gfx, const GFXfont& font) {
+    int16_t x = 0, y = font.yAdvance;
+    gfx.setFont(&font);
+
+    for (uint16_t c = font.first; c <= font.last; c++) {
+        const GFXglyph& glyph = font.glyph[c - font.first];
+
+        if (x + glyph.xAdvance > gfx.width()) {
+            x = 0;
+            y += font.yAdvance;
+        }
+
+        gfx.drawChar(x, y, c, 1, 0, 1);
+        x += glyph.xAdvance;
+    }
+}
+
+// Microseconds per glyph
+double time_glyphs(Adafruit_GFX& gfx, const GFXfont& font) {
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < ITERATIONS; i++) draw_glyphs(gfx, font);
+
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITERATIONS / (font.last - font.first + 1);
+}
+
+bool same_pixels(const GFXfont& a, const GFXfont& b) {
+    auto gfx_a = std::make_unique<Adafruit_GFX>();
+    auto gfx_b = std::make_unique<Adafruit_GFX>();
+
+    gfx_a->fillScreen(0);
+    gfx_b->fillScreen(0);
+
+    draw_glyphs(*gfx_a, a);
+    draw_glyphs(*gfx_b, b);
+
+    return memcmp(gfx_a->getBuffer(), gfx_b->getBuffer(), FRAMEBUFFER_SIZE) == 0;
+}
+
+}  // namespace
+
+int main() {
+    const font_pair_t fonts[] = {{"FreeSerif24pt7b", &font::freeSerif24pt7b, &font::freeSerif24pt7bRle},
+                                 {"FreeSans24pt7b", &font::freeSans24pt7b, &font::freeSans24pt7bRle},
+                                 {"FreeSerif18pt7b", &font::freeSerif18pt7b, &font::freeSerif18pt7bRle},
+                                 {"FreeSans18pt7b", &font::freeSans18pt7b, &font::freeSans18pt7bRle}};
+
+    auto gfx = std::make_unique<Adafruit_GFX>();
+    bool ok = true;
+
+    printf("%-16s %10s %10s %12s %12s %6s\n", "font", "raw bytes", "rle bytes", "raw us/glyph", "rle us/glyph",
+           "pixels");
+
+    for (const font_pair_t& pair : fonts) {
+        const bool same = same_pixels(*pair.raw, *pair.rle);
+        ok &= same;
+
+        const double raw_us = time_glyphs(*gfx, *pair.raw);
+        const double rle_us = time_glyphs(*gfx, *pair.rle);
+
+        printf("%-16s %10zu %10zu %12.3f %12.3f %6s\n", pair.name, bitmap_size(*pair.raw), bitmap_size(*pair.rle),
+               raw_us, rle_us, same ? "same" : "DIFFER");
+    }
+
+    return ok ? 0 : 1;
+}
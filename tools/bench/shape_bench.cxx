@@ -0,0 +1,202 @@
+// Compares the span fills of Adafruit_GFX with the previous column-wise, per-pixel fills: time per filled rect,
+// circle, round rect and triangle at several sizes. Both are checked to draw the same pixels.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "display/adagfx.h"
+
+namespace {
+
+constexpr size_t FRAMEBUFFER_SIZE = (400 * 300) >> 3;
+constexpr int16_t RADII[] = {4, 8, 16, 32, 64, 120};
+
+// The previous implementation, column by column through drawFastVLine
+namespace reference {
+
+void fillRect(Adafruit_GFX& gfx, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color) {
+    for (int16_t i = x; i < x + w; i++) gfx.drawFastVLine(i, y, h, color);
+}
+
+void fillCircleHelper(Adafruit_GFX& gfx, int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta,
+                      uint8_t color) {
+    int16_t f = 1 - r;
+    int16_t ddF_x = 1;
+    int16_t ddF_y = -2 * r;
+    int16_t x = 0;
+    int16_t y = r;
+    int16_t px = x;
+    int16_t py = y;
+
+    delta++;
+
+    while (x < y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+
+        if (x < (y + 1)) {
+            if (corners & 1) gfx.drawFastVLine(x0 + x, y0 - y, 2 * y + delta, color);
+            if (corners & 2) gfx.drawFastVLine(x0 - x, y0 - y, 2 * y + delta, color);
+        }
+        if (y != py) {
+            if (corners & 1) gfx.drawFastVLine(x0 + py, y0 - px, 2 * px + delta, color);
+            if (corners & 2) gfx.drawFastVLine(x0 - py, y0 - px, 2 * px + delta, color);
+            py = y;
+        }
+        px = x;
+    }
+}
+
+void fillCircle(Adafruit_GFX& gfx, int16_t x0, int16_t y0, int16_t r, uint8_t color) {
+    gfx.drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+    fillCircleHelper(gfx, x0, y0, r, 3, 0, color);
+}
+
+void fillRoundRect(Adafruit_GFX& gfx, int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint8_t color) {
+    int16_t max_radius = ((w < h) ? w : h) / 2;
+    if (r > max_radius) r = max_radius;
+
+    fillRect(gfx, x + r, y, w - 2 * r, h, color);
+    fillCircleHelper(gfx, x + w - r - 1, y + r, r, 1, h - 2 * r - 1, color);
+    fillCircleHelper(gfx, x + r, y + r, r, 2, h - 2 * r - 1, color);
+}
+
+void hLine(Adafruit_GFX& gfx, int16_t x, int16_t y, int16_t w, uint8_t color) {
+    for (int16_t i = x; i < x + w; i++) gfx.drawPixel(i, y, color);
+}
+
+// The same scanlines as Adafruit_GFX::fillTriangle, drawn pixel by pixel
+void fillTriangle(Adafruit_GFX& gfx, int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+                  uint8_t color) {
+    if (y0 > y1) {
+        std::swap(y0, y1);
+        std::swap(x0, x1);
+    }
+    if (y1 > y2) {
+        std::swap(y2, y1);
+        std::swap(x2, x1);
+    }
+    if (y0 > y1) {
+        std::swap(y0, y1);
+        std::swap(x0, x1);
+    }
+
+    if (y0 == y2) {
+        int16_t a = std::min({x0, x1, x2}), b = std::max({x0, x1, x2});
+        hLine(gfx, a, y0, b - a + 1, color);
+        return;
+    }
+
+    int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+    int32_t sa = 0, sb = 0;
+    int16_t y, last = y1 == y2 ? y1 : y1 - 1;
+
+    for (y = y0; y <= last; y++) {
+        int16_t a = x0 + sa / dy01;
+        int16_t b = x0 + sb / dy02;
+        sa += dx01;
+        sb += dx02;
+
+        if (a > b) std::swap(a, b);
+        hLine(gfx, a, y, b - a + 1, color);
+    }
+
+    sa = static_cast<int32_t>(dx12) * (y - y1);
+    sb = static_cast<int32_t>(dx02) * (y - y0);
+
+    for (; y <= y2; y++) {
+        int16_t a = x1 + sa / dy12;
+        int16_t b = x0 + sb / dy02;
+        sa += dx12;
+        sb += dx02;
+
+        if (a > b) std::swap(a, b);
+        hLine(gfx, a, y, b - a + 1, color);
+    }
+}
+
+}  // namespace reference
+
+struct shape_t {
+    const char* name;
+    std::function<void(Adafruit_GFX&, int16_t)> span;
+    std::function<void(Adafruit_GFX&, int16_t)> reference;
+};
+
+// Shapes of size r, centered on the framebuffer
+const shape_t SHAPES[] = {
+    {"rect", [](Adafruit_GFX& gfx, int16_t r) { gfx.fillRect(200 - r, 150 - r, 2 * r + 1, 2 * r + 1, 1); },
+     [](Adafruit_GFX& gfx, int16_t r) { reference::fillRect(gfx, 200 - r, 150 - r, 2 * r + 1, 2 * r + 1, 1); }},
+    {"circle", [](Adafruit_GFX& gfx, int16_t r) { gfx.fillCircle(200, 150, r, 1); },
+     [](Adafruit_GFX& gfx, int16_t r) { reference::fillCircle(gfx, 200, 150, r, 1); }},
+    {"round rect", [](Adafruit_GFX& gfx, int16_t r) { gfx.fillRoundRect(200 - r, 150 - r / 2, 2 * r, r, r / 4, 1); },
+     [](Adafruit_GFX& gfx, int16_t r) { reference::fillRoundRect(gfx, 200 - r, 150 - r / 2, 2 * r, r, r / 4, 1); }},
+    {"triangle",
+     [](Adafruit_GFX& gfx, int16_t r) { gfx.fillTriangle(200, 150 - r, 200 + r, 150 + r, 200 - r, 150 + r / 2, 1); },
+     [](Adafruit_GFX& gfx, int16_t r) {
+         reference::fillTriangle(gfx, 200, 150 - r, 200 + r, 150 + r, 200 - r, 150 + r / 2, 1);
+     }}};
+
+// Microseconds per shape, repeated for about 50 ms
+double time_shape(Adafruit_GFX& gfx, const std::function<void(Adafruit_GFX&, int16_t)>& draw, int16_t r) {
+    int iterations = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::micro> elapsed{0};
+
+    while (elapsed.count() < 50000) {
+        for (int i = 0; i < 100; i++) draw(gfx, r);
+
+        iterations += 100;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+    return elapsed.count() / iterations;
+}
+
+bool same_pixels(const shape_t& shape, int16_t r) {
+    auto gfx_span = std::make_unique<Adafruit_GFX>();
+    auto gfx_reference = std::make_unique<Adafruit_GFX>();
+
+    gfx_span->fillScreen(0);
+    gfx_reference->fillScreen(0);
+
+    shape.span(*gfx_span, r);
+    shape.reference(*gfx_reference, r);
+
+    return memcmp(gfx_span->getBuffer(), gfx_reference->getBuffer(), FRAMEBUFFER_SIZE) == 0;
+}
+
+}  // namespace
+
+int main() {
+    auto gfx = std::make_unique<Adafruit_GFX>();
+    bool ok = true;
+
+    printf("%-12s %6s %14s %14s %8s %6s\n", "shape", "r", "per pixel us", "spans us", "speedup", "pixels");
+
+    for (const shape_t& shape : SHAPES) {
+        for (int16_t r : RADII) {
+            const bool same = same_pixels(shape, r);
+            ok &= same;
+
+            const double reference_us = time_shape(*gfx, shape.reference, r);
+            const double span_us = time_shape(*gfx, shape.span, r);
+
+            printf("%-12s %6i %14.3f %14.3f %7.1fx %6s\n", shape.name, r, reference_us, span_us,
+                   reference_us / span_us, same ? "same" : "DIFFER");
+        }
+    }
+
+    return ok ? 0 : 1;
+}
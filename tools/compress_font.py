@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""
+Convert an Adafruit GFX font source (as found in main/display/font) into a
+variant with run-length encoded glyph bitmaps.
+
+Each glyph is encoded row by row. The first byte of a row is either
+
+    0x00         an empty row
+    0x01 - 0x0f  repeat the previous row n times
+    0xHL         skip H - 1 pixels, then set L pixels
+
+and is followed by further 0xHL tokens (skip H pixels, set L pixels) until the
+glyph width is covered. A 0x00 token terminates a row early, the remainder is
+left blank.
+
+Glyphs that do not shrink are kept in the raw format. RLE glyphs are flagged by
+bit 15 of bitmapOffset (GFX_GLYPH_RLE in gfxfont.h).
+"""
+
+import argparse
+import re
+import sys
+
+GLYPH_RLE = 0x8000
+
+
+def parse(source):
+    bitmap_match = re.search(r"(\w+)Bitmaps\[\]\s*=\s*\{(.*?)\};", source, re.S)
+    glyph_match = re.search(r"Glyphs\[\]\s*=\s*\{(.*?)\};", source, re.S)
+    font_match = re.search(r"const GFXfont (font::\w+)\s*=\s*\{[^,]*,[^,]*,\s*(\w+),\s*(\w+),\s*(\w+)\s*\};", source,
+                           re.S)
+
+    if not bitmap_match or not glyph_match or not font_match:
+        raise ValueError("not a GFX font source")
+
+    bitmap = [int(byte, 16) for byte in re.findall(r"0x[0-9A-Fa-f]{2}", bitmap_match.group(2))]
+    glyphs = [
+        tuple(int(field) for field in glyph)
+        for glyph in re.findall(r"\{\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+),\s*(-?\d+)\s*\}",
+                                glyph_match.group(1))
+    ]
+
+    return bitmap_match.group(1), bitmap, glyphs, font_match.groups()
+
+
+def glyph_rows(bitmap, offset, width, height):
+    bits = [(bitmap[offset + (i >> 3)] >> (7 - (i & 7))) & 1 for i in range(width * height)]
+
+    return [bits[row * width:(row + 1) * width] for row in range(height)]
+
+
+def runs(row):
+    result = []
+    current, length = 0, 0
+
+    for pixel in row:
+        if pixel == current:
+            length += 1
+        else:
+            result.append(length)
+            current, length = pixel, 1
+
+    result.append(length)
+    if current == 0: result.pop()
+    if len(result) % 2: result.append(0)
+
+    return [(result[i], result[i + 1]) for i in range(0, len(result), 2)]
+
+
+def encode_row(row):
+    if not any(row): return [0x00]
+
+    tokens = []
+    covered = 0
+    bias = 1
+
+    for skip, fill in runs(row):
+        covered += skip + fill
+
+        while skip > 15 - bias:
+            tokens.append(15 << 4)
+            skip -= 15 - bias
+            bias = 0
+
+        while fill > 15:
+            tokens.append(((skip + bias) << 4) | 15)
+            skip, fill, bias = 0, fill - 15, 0
+
+        tokens.append(((skip + bias) << 4) | fill)
+        bias = 0
+
+    if covered < len(row): tokens.append(0x00)
+
+    return tokens
+
+
+def encode_glyph(rows):
+    tokens = []
+    previous = None
+    i = 0
+
+    while i < len(rows):
+        if rows[i] == previous and any(previous):
+            count = 0
+            while i < len(rows) and rows[i] == previous and count < 15:
+                count += 1
+                i += 1
+
+            tokens.append(count)
+            continue
+
+        tokens += encode_row(rows[i])
+        previous = rows[i]
+        i += 1
+
+    return tokens
+
+
+def compress(bitmap, glyphs):
+    data = []
+    compressed_glyphs = []
+
+    for offset, width, height, x_advance, x_offset, y_offset in glyphs:
+        raw_len = (width * height + 7) >> 3
+        raw = bitmap[offset:offset + raw_len]
+        encoded = encode_glyph(glyph_rows(bitmap, offset, width, height)) if raw_len > 0 else []
+
+        flag = 0
+        if len(encoded) < raw_len:
+            raw = encoded
+            flag = GLYPH_RLE
+
+        if len(data) >= GLYPH_RLE: raise ValueError("compressed bitmap too large")
+
+        compressed_glyphs.append((len(data) | flag, width, height, x_advance, x_offset, y_offset))
+        data += raw
+
+    return data, compressed_glyphs
+
+
+def render(name, data, glyphs, font, declare):
+    symbol, first, last, y_advance = font
+
+    lines = ["#include <cstdint>", "", '#include "display/font.h"', "",
+             "// Generated by tools/compress_font.py, do not edit", ""]
+
+    # A renamed font is not declared in font.h
+    if declare:
+        namespace, _, short_symbol = symbol.rpartition("::")
+        lines += [f"namespace {namespace} {{ extern const GFXfont {short_symbol}; }}", ""]
+
+    lines += [f"const uint8_t {name}BitmapsRle[] = {{"]
+
+    for i in range(0, len(data), 19):
+        lines.append("    " + ", ".join(f"0x{byte:02X}" for byte in data[i:i + 19]) + ",")
+
+    lines += ["};", "", f"const GFXglyph {name}GlyphsRle[] = {{"]
+    lines += [f"    {{{', '.join(str(field) for field in glyph)}}}," for glyph in glyphs]
+    lines += ["};", "",
+              f"const GFXfont {symbol} = {{(uint8_t *){name}BitmapsRle, (GFXglyph *){name}GlyphsRle, {first}, {last},",
+              f"    {y_advance}}};", ""]
+
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="GFX font source")
+    parser.add_argument("output", help="generated font source")
+    parser.add_argument("--symbol", help="name of the generated GFXfont (default: that of the input)")
+    args = parser.parse_args()
+
+    with open(args.input) as file:
+        name, bitmap, glyphs, font = parse(file.read())
+
+    if args.symbol: font = (args.symbol, ) + font[1:]
+
+    data, compressed_glyphs = compress(bitmap, glyphs)
+
+    with open(args.output, "w") as file:
+        file.write(render(name, data, compressed_glyphs, font, args.symbol is not None))
+
+    rle_count = sum(1 for glyph in compressed_glyphs if glyph[0] & GLYPH_RLE)
+    print(f"{name}: {len(bitmap)} -> {len(data)} bytes ({100 * len(data) // max(len(bitmap), 1)}%), "
+          f"{rle_count}/{len(glyphs)} glyphs RLE encoded")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
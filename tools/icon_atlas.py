@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Convert XBM icons into a sprite atlas in framebuffer bit order (MSB first).
+
+For every icon, 8 copies are generated, one for each sub-byte alignment, so
+the sprites can be blitted with plain byte operations. Each copy has the same
+stride (bytes per row) and starts at shift * height * stride.
+
+Generates display/icon.h and display/icon.cxx in the output directory. Icons
+are named after their file, e.g. battery-full.xbm becomes icon::battery_full.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+def parse_xbm(path):
+    with open(path) as file:
+        source = file.read()
+
+    width = int(re.search(r"#define\s+\w+_width\s+(\d+)", source).group(1))
+    height = int(re.search(r"#define\s+\w+_height\s+(\d+)", source).group(1))
+    data = [int(byte, 16) for byte in re.findall(r"0x[0-9A-Fa-f]{2}", source.split("{", 1)[1])]
+
+    xbm_stride = (width + 7) >> 3
+    if len(data) != xbm_stride * height: raise ValueError(f"{path}: bad XBM data")
+
+    # XBM is LSB first
+    return width, height, [[(data[y * xbm_stride + (x >> 3)] >> (x & 7)) & 1 for x in range(width)]
+                           for y in range(height)]
+
+
+def shifted_copies(width, height, pixels):
+    stride = (width + 7 + 7) >> 3
+    data = []
+
+    for shift in range(8):
+        for row in pixels:
+            bytes_ = [0] * stride
+
+            for x, pixel in enumerate(row):
+                if pixel: bytes_[(x + shift) >> 3] |= 0x80 >> ((x + shift) & 7)
+
+            data += bytes_
+
+    return stride, data
+
+
+def icon_name(path):
+    return re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0])
+
+
+def render_header(names):
+    lines = ["#ifndef _ICON_H_", "#define _ICON_H_", "", '#include "display/gfxsprite.h"', "",
+             "// Generated by tools/icon_atlas.py, do not edit", "", "namespace icon {", ""]
+    lines += [f"extern const GFXsprite {name};" for name in names]
+    lines += ["", "}  // namespace icon", "", "#endif  // _ICON_H_", ""]
+
+    return "\n".join(lines)
+
+
+def render_source(icons):
+    lines = ['#include "display/icon.h"', "", "// Generated by tools/icon_atlas.py, do not edit", "", "namespace {", ""]
+
+    for name, _, _, _, data in icons:
+        lines.append(f"const uint8_t {name}_data[] = {{")
+
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join(f"0x{byte:02x}" for byte in data[i:i + 16]) + ",")
+
+        lines += ["};", ""]
+
+    lines += ["}  // namespace", ""]
+    lines += [f"const GFXsprite icon::{name} = {{{name}_data, {width}, {height}, {stride}}};"
+              for name, width, height, stride, _ in icons]
+    lines.append("")
+
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", help="output directory")
+    parser.add_argument("icons", nargs="+", help="XBM icons")
+    args = parser.parse_args()
+
+    icons = []
+    for path in sorted(args.icons):
+        width, height, pixels = parse_xbm(path)
+        stride, data = shifted_copies(width, height, pixels)
+
+        icons.append((icon_name(path), width, height, stride, data))
+
+    os.makedirs(os.path.join(args.output, "display"), exist_ok=True)
+
+    with open(os.path.join(args.output, "display", "icon.h"), "w") as file:
+        file.write(render_header([icon[0] for icon in icons]))
+
+    with open(os.path.join(args.output, "display", "icon.cxx"), "w") as file:
+        file.write(render_source(icons))
+
+    print(f"icon atlas: {len(icons)} icons, {sum(len(icon[4]) for icon in icons)} bytes")
+
+
+if __name__ == "__main__":
+    sys.exit(main())